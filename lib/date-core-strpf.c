@@ -287,14 +287,10 @@ __strpd_card(struct strpd_s *d, const char *sp, struct dt_spec_s s, char **ep)
 		/* ymcw mode? */
 		switch (s.abbr) {
 		case DT_SPMOD_NORM:
-			d->w = strtoarri(
-				sp, &sp,
-				dut_abbr_wday, dut_nabbr_wday);
+			d->w = dut_strtoi_abbr_wday(sp, &sp);
 			break;
 		case DT_SPMOD_LONG:
-			d->w = strtoarri(
-				sp, &sp,
-				dut_long_wday, dut_nlong_wday);
+			d->w = dut_strtoi_long_wday(sp, &sp);
 			break;
 		case DT_SPMOD_ABBR: {
 			const char *pos;
@@ -314,14 +310,10 @@ __strpd_card(struct strpd_s *d, const char *sp, struct dt_spec_s s, char **ep)
 	case DT_SPFL_S_MON:
 		switch (s.abbr) {
 		case DT_SPMOD_NORM:
-			d->m = strtoarri(
-				sp, &sp,
-				dut_abbr_mon, dut_nabbr_mon);
+			d->m = dut_strtoi_abbr_mon(sp, &sp);
 			break;
 		case DT_SPMOD_LONG:
-			d->m = strtoarri(
-				sp, &sp,
-				dut_long_mon, dut_nlong_mon);
+			d->m = dut_strtoi_long_mon(sp, &sp);
 			break;
 		case DT_SPMOD_ABBR: {
 #if 0
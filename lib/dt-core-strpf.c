@@ -146,6 +146,137 @@ __fixup_zdiff(struct dt_dt_s dt, int32_t zdiff)
 	return dt;
 }
 
+
+/* fast path for the prevalent ISO 8601 shapes
+ * YYYY-MM-DD and YYYY-MM-DD[T ]HH:MM[:SS[.fff]]
+ * We load 8 bytes at a time, compare the separator slots under a mask,
+ * validate the remaining digits in one go and decode the fields from
+ * there, anything unusual is left to the byte-wise code below.
+ * Strings shorter than 16 bytes are loaded from a \nul-padded copy. */
+#define ISO_ONES	(0x0101010101010101ULL)
+
+enum {
+	ISO_NONE,
+	ISO_D,
+	ISO_DT,
+};
+
+static inline uint64_t
+__iso_ld8(const char *s)
+{
+/* load 8 bytes, S[0] becoming the least significant byte */
+	uint64_t x;
+
+	memcpy(&x, s, sizeof(x));
+	return le64toh(x);
+}
+
+static inline bool
+__iso_digits_p(uint64_t x)
+{
+/* all 8 bytes '0' to '9'? */
+	return (x & 0xf0U * ISO_ONES) == 0x30U * ISO_ONES &&
+		((x + 0x06U * ISO_ONES) & 0xf0U * ISO_ONES) == 0x30U * ISO_ONES;
+}
+
+static inline unsigned int
+__iso_dig(uint64_t x, unsigned int i)
+{
+/* the I-th byte of X as digit */
+	return (unsigned int)(x >> (8U * i)) & 0xfU;
+}
+
+static int
+__strpdt_iso(struct strpdt_s *restrict d, const char *str, const char **ep)
+{
+	/* separator slots, and what's expected there */
+	static const uint64_t dmsk = 0xffULL << 32U | 0xffULL << 56U;
+	static const uint64_t dsep = (uint64_t)'-' << 32U | (uint64_t)'-' << 56U;
+	static const uint64_t tmsk = 0xffULL << 40U | 0xffULL << 16U;
+	static const uint64_t tsep = (uint64_t)':' << 40U;
+	char tmp[16U] = {0};
+	const char *s = str;
+	const char *z;
+	const char *sp;
+	uint64_t a, b;
+
+	if ((z = memchr(str, '\0', sizeof(tmp))) != NULL) {
+		/* only the bytes up to the \nul are ours to load */
+		if (z - str < 10) {
+			return ISO_NONE;
+		}
+		memcpy(tmp, str, z - str);
+		s = tmp;
+	}
+	/* YYYY-MM- */
+	a = __iso_ld8(s);
+	if ((a & dmsk) != dsep ||
+	    !__iso_digits_p((a & ~dmsk) | (0x30U * ISO_ONES & dmsk))) {
+		return ISO_NONE;
+	}
+	/* DD?HH:MM */
+	b = __iso_ld8(s + 8U);
+	switch (str[10U]) {
+	case 'T':
+	case ' ':
+	case '\t':
+		break;
+	case '0' ... '9':
+	case '-':
+	case 'B':
+	case 'b':
+		/* longer days, ymcw or bizda dates */
+		return ISO_NONE;
+	default:
+		/* only DD matters */
+		if (!__iso_digits_p((b & 0xffffU) | 0x30U * ISO_ONES << 16U)) {
+			return ISO_NONE;
+		}
+		goto date;
+	}
+	/* the date/time separator has been checked already */
+	if ((b & tmsk & ~0xff0000ULL) != tsep ||
+	    !__iso_digits_p((b & ~tmsk) | (0x30U * ISO_ONES & tmsk))) {
+		return ISO_NONE;
+	}
+	d->st.h = __iso_dig(b, 3U) * 10U + __iso_dig(b, 4U);
+	d->st.m = __iso_dig(b, 6U) * 10U + __iso_dig(b, 7U);
+	if (UNLIKELY(d->st.h > 23 || d->st.m > 59)) {
+		return ISO_NONE;
+	}
+	sp = str + 16U;
+	if (*sp == ':') {
+		if ((unsigned char)(sp[1U] ^ '0') >= 10U ||
+		    (unsigned char)(sp[2U] ^ '0') >= 10U) {
+			return ISO_NONE;
+		}
+		d->st.s = (sp[1U] ^ '0') * 10 + (sp[2U] ^ '0');
+		if (UNLIKELY(d->st.s > 60)) {
+			return ISO_NONE;
+		}
+		sp += 3U;
+		if (*sp == '.') {
+			/* nanoseconds aren't kept, just overread them */
+			const char *const zp = ++sp + 9U;
+			for (; sp < zp && (unsigned char)(*sp ^ '0') < 10U; sp++);
+		}
+	}
+	*ep = sp;
+date:
+	d->sd.y = __iso_dig(a, 0U) * 1000U + __iso_dig(a, 1U) * 100U +
+		__iso_dig(a, 2U) * 10U + __iso_dig(a, 3U);
+	d->sd.m = __iso_dig(a, 5U) * 10U + __iso_dig(a, 6U);
+	d->sd.d = __iso_dig(b, 0U) * 10U + __iso_dig(b, 1U);
+	d->sd.c = -1;
+	if (UNLIKELY(d->sd.y < DT_MIN_YEAR || d->sd.y > DT_MAX_YEAR ||
+		     d->sd.m < 1 || d->sd.m > 12 ||
+		     d->sd.d < 1 || d->sd.d > 31)) {
+		return ISO_NONE;
+	}
+	return str[10U] == 'T' || str[10U] == ' ' || str[10U] == '\t'
+		? ISO_DT : ISO_D;
+}
+
 DEFUN struct dt_dt_s
 __strpdt_std(const char *str, char **ep)
 {
@@ -171,6 +302,21 @@ __strpdt_std(const char *str, char **ep)
 		}
 		goto out;
 	}
+	switch (__strpdt_iso(&d, str, &sp)) {
+	case ISO_D:
+		res.d = __guess_dtyp(d.sd);
+		dt_make_d_only(&res, res.d.typ);
+		sp = str + 10U;
+		goto out;
+	case ISO_DT:
+		res.d = __guess_dtyp(d.sd);
+		goto eval_time;
+	default:
+		/* reset, __strpdt_iso() might have scribbled */
+		d = (struct strpdt_s){0};
+		sp = str;
+		break;
+	}
 	with (char *tmp) {
 		/* let date-core do the hard yakka */
 		if ((res.d = __strpd_std(str, &tmp)).typ == DT_DUNK) {
@@ -609,20 +609,218 @@ need_milfup_p(const char *fmt)
 
 
 /* parser implementations */
-DEFUN struct dt_dt_s
-dt_strpdt(const char *str, const char *fmt, char **ep)
+struct __strpdt_op_s {
+	struct dt_spec_s spec;
+	/* first format char of this op, \nul terminates the program */
+	char fc;
+};
+
+/* formats with more ops than this are compiled onto the heap by dt_strpdt() */
+#define STRPDT_STK_NOPS	(128U)
+
+struct dt_strpdt_prog_s {
+	/* what __trans_dtfmt() made of the format */
+	dt_dttyp_t typ;
+	const struct __strpdt_op_s *op;
+	/* ops after which dt_strpdt_memo_run() remembers the state */
+	uint64_t memo;
+};
+
+static void
+__comp_strpdt(struct __strpdt_op_s *restrict op, const char *fmt, size_t len)
+{
+/* tokenise FMT, of length LEN, into OP which has room for LEN + 1 ops */
+	const char *const eof = fmt + len;
+
+	/* a trailing lone % makes __tok_spec() step over the \nul */
+	for (const char *fp = fmt; fp < eof; op++) {
+		const char *fp_sav = fp;
+
+		op->spec = __tok_spec(fp_sav, &fp);
+		op->fc = *fp_sav;
+	}
+	op->fc = '\0';
+	return;
+}
+
+static inline int
+__strpdt_op(struct strpdt_s *restrict d, const char **sp,
+	    const struct __strpdt_op_s *op)
+{
+/* run OP on *SP, advancing *SP, return -1 if it doesn't match */
+	const struct dt_spec_s spec = op->spec;
+	const char *tp = *sp;
+
+	if (spec.spfl == DT_SPFL_UNK) {
+		/* must be literal */
+		if (UNLIKELY(op->fc != *tp++)) {
+			return -1;
+		}
+	} else if (LIKELY(!spec.rom)) {
+		const char *sp_sav = tp;
+		if (__strpdt_card(d, tp, spec, (char**)&tp) < 0) {
+			return -1;
+		}
+		if (spec.ord &&
+		    __ordinalp(sp_sav, tp - sp_sav, (char**)&tp) < 0) {
+			;
+		}
+		if (spec.bizda) {
+			switch (*tp++) {
+			case 'B':
+				d->sd.flags.ab = BIZDA_BEFORE;
+			case 'b':
+				d->sd.flags.bizda = 1;
+				break;
+			default:
+				/* it's a bizda anyway */
+				d->sd.flags.bizda = 1;
+				tp--;
+				break;
+			}
+		}
+	} else if (UNLIKELY(spec.rom)) {
+		if (__strpd_rom(&d->sd, tp, spec, (char**)&tp) < 0) {
+			return -1;
+		}
+	}
+	*sp = tp;
+	return 0;
+}
+
+static struct dt_dt_s
+__strpdt_fini(struct strpdt_s d, bool datep)
+{
+/* turn parsed D into a dt, DATEP to ignore seconds since the epoch */
+	struct dt_dt_s res = {DT_UNK};
+
+	/* check if it's a sexy type */
+	if (d.i && !datep) {
+		res.typ = DT_SEXY;
+		res.sexy = d.i;
+	} else {
+		/* assign d and t types using date and time core routines */
+		d = massage_strpdt(d);
+		res.d = __guess_dtyp(d.sd);
+		res.t = __guess_ttyp(d.st);
+
+		if (res.d.typ > DT_DUNK && res.t.typ > DT_TUNK) {
+			res.sandwich = 1;
+		} else if (res.d.typ > DT_DUNK) {
+			res.t.typ = DT_TUNK;
+			res.sandwich = 0;
+		} else if (res.t.typ > DT_TUNK) {
+			res.d.typ = DT_DUNK;
+			res.sandwich = 1;
+		}
+	}
+	if (d.zdiff && dt_sandwich_p(res)) {
+		res = __fixup_zdiff(res, d.zdiff);
+	} else if (d.zngvn && dt_sandwich_p(res)) {
+		res.znfxd = 1;
+	}
+	return res;
+}
+
+/* memos of parsed prefixes, per program the points at which parsing
+ * the last string can be resumed and the bytes leading up to them,
+ * up to MEMO_NPT points per program, for MEMO_NSLOT programs */
+#define MEMO_MAX	(64U)
+#define MEMO_NPT	(4U)
+#define MEMO_NSLOT	(8U)
+
+struct __strpdt_memo_pt_s {
+	/* the op to resume with */
+	const struct __strpdt_op_s *op;
+	/* resume at STR + N, given Z bytes of STR match the prefix */
+	uint8_t n;
+	uint8_t z;
+	struct strpdt_s d;
+};
+
+struct __strpdt_memo_slot_s {
+	const struct dt_strpdt_prog_s *prog;
+	size_t npt;
+	struct __strpdt_memo_pt_s pt[MEMO_NPT];
+	char pfx[MEMO_MAX];
+};
+
+struct dt_strpdt_memo_s {
+	/* slot to evict next */
+	size_t vict;
+	struct __strpdt_memo_slot_s slot[MEMO_NSLOT];
+};
+
+static inline bool
+__memo_op_p(const struct __strpdt_op_s *op, bool *peek)
+{
+/* whether OP reads nothing but its own bytes going forward, and at most
+ * one byte past them, which is when PEEK is set, so that the state
+ * after it is down to the bytes up to there */
+	const struct dt_spec_s s = op->spec;
+
+	if (s.rom || s.ord || s.bizda) {
+		return false;
+	}
+	switch (s.spfl) {
+	case DT_SPFL_UNK:
+	case DT_SPFL_LIT_PERCENT:
+	case DT_SPFL_LIT_TAB:
+	case DT_SPFL_LIT_NL:
+		*peek = false;
+		return true;
+	case DT_SPFL_N_YEAR:
+		/* short years depend on the base */
+		if (s.abbr != DT_SPMOD_LONG) {
+			break;
+		}
+		/*@fallthrough@*/
+	case DT_SPFL_N_DSTD:
+	case DT_SPFL_N_MON:
+	case DT_SPFL_N_DCNT_MON:
+	case DT_SPFL_N_TSTD:
+	case DT_SPFL_N_HOUR:
+	case DT_SPFL_N_MIN:
+	case DT_SPFL_N_SEC:
+		*peek = true;
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+static uint64_t
+__memo_msk(const struct __strpdt_op_s *op)
+{
+/* the last MEMO_NPT ops of the leading run of memoisable ones,
+ * bar the final op which leaves nothing to resume */
+	uint64_t res = 0U;
+	bool peek;
+
+	for (size_t i = 0U; i < 64U && op[i].fc && op[i + 1U].fc &&
+		     __memo_op_p(op + i, &peek); i++) {
+		res |= 1ULL << i;
+		if (__builtin_popcountll(res) > (int)MEMO_NPT) {
+			res &= res - 1U;
+		}
+	}
+	return res;
+}
+
+static struct dt_dt_s
+__strpdt_prog(
+	const char *str, const struct dt_strpdt_prog_s *p,
+	struct __strpdt_memo_slot_s *m, char **ep)
 {
 	struct dt_dt_s res = {DT_UNK};
 	struct strpdt_s d = {0};
 	const char *sp = str;
-	const char *fp;
+	const struct __strpdt_op_s *op;
 	int transd = 0;
 
-	if (LIKELY(fmt == NULL)) {
-		return __strpdt_std(str, ep);
-	}
 	/* translate high-level format names, for sandwiches */
-	switch ((dt_dtyp_t)__trans_dtfmt(&fmt)) {
+	switch ((dt_dtyp_t)p->typ) {
 		char *on;
 	default:
 		transd++;
@@ -708,107 +906,584 @@ dt_strpdt(const char *str, const char *fmt, char **ep)
 		goto sober;
 	}
 
-	fp = fmt;
-	while (*fp && *sp) {
-		const char *fp_sav = fp;
-		struct dt_spec_s spec = __tok_spec(fp_sav, &fp);
+	op = p->op;
+	if (m != NULL) {
+		/* resume from the deepest point whose prefix STR shares */
+		size_t z = 0U;
+		size_t k;
 
-		if (spec.spfl == DT_SPFL_UNK) {
-			/* must be literal */
-			if (UNLIKELY(*fp_sav != *sp++)) {
-				goto fucked;
+		if (m->npt) {
+			const size_t zmax = m->pt[m->npt - 1U].z;
+
+			for (; z < zmax && str[z] == m->pfx[z]; z++);
+		}
+		for (k = m->npt; k > 0U && m->pt[k - 1U].z > z; k--);
+		if ((m->npt = k) > 0U) {
+			op = m->pt[k - 1U].op;
+			sp = str + m->pt[k - 1U].n;
+			d = m->pt[k - 1U].d;
+		}
+	}
+	for (; op->fc && *sp; op++) {
+		/* the memo mask only covers the first 64 ops */
+		const size_t idx = op - p->op;
+
+		if (__strpdt_op(&d, &sp, op) < 0) {
+			goto fucked;
+		} else if (m != NULL && idx < 64U && (p->memo >> idx & 1U)) {
+			/* the prefix up to here tells the state, if
+			 * op peeked, the byte after it as well */
+			const size_t z0 = m->npt ? m->pt[m->npt - 1U].z : 0U;
+			bool peek = false;
+			size_t z;
+
+			__memo_op_p(op, &peek);
+			if ((z = sp - str + peek) > MEMO_MAX) {
+				m = NULL;
+				continue;
 			}
-		} else if (LIKELY(!spec.rom)) {
-			const char *sp_sav = sp;
-			if (__strpdt_card(&d, sp, spec, (char**)&sp) < 0) {
-				goto fucked;
+			memcpy(m->pfx + z0, str + z0, z - z0);
+			m->pt[m->npt++] = (struct __strpdt_memo_pt_s){
+				.op = op + 1U,
+				.n = (uint8_t)(sp - str),
+				.z = (uint8_t)z,
+				.d = d,
+			};
+		}
+	}
+	/* check suffix literal */
+	if (!*sp && transd && op->fc == 'T') {
+		/* think we just parsed the date bit */
+		res = __strpdt_fini(d, true);
+		goto sober;
+	}
+	if (op->fc && op->fc != *sp) {
+		goto fucked;
+	}
+	res = __strpdt_fini(d, false);
+
+sober:
+	/* set the end pointer */
+	if (ep != NULL) {
+		*ep = (char*)sp;
+	}
+	return res;
+fucked:
+	if (ep != NULL) {
+		*ep = (char*)str;
+	}
+	return (struct dt_dt_s){DT_UNK};
+}
+
+DEFUN struct dt_dt_s
+dt_strpdt(const char *str, const char *fmt, char **ep)
+{
+	struct dt_strpdt_prog_s p;
+	size_t len;
+
+	if (LIKELY(fmt == NULL)) {
+		return __strpdt_std(str, ep);
+	}
+	p.typ = __trans_dtfmt(&fmt);
+	len = strlen(fmt);
+	{
+		struct __strpdt_op_s stk[STRPDT_STK_NOPS];
+		struct __strpdt_op_s *op = stk;
+		struct dt_dt_s res;
+
+		if (UNLIKELY(len >= countof(stk)) &&
+		    UNLIKELY((op = malloc((len + 1U) * sizeof(*op))) == NULL)) {
+			if (ep != NULL) {
+				*ep = (char*)str;
 			}
-			if (spec.ord &&
-			    __ordinalp(sp_sav, sp - sp_sav, (char**)&sp) < 0) {
-				;
+			return (struct dt_dt_s){DT_UNK};
+		}
+		__comp_strpdt(op, fmt, len);
+		p.op = op;
+		p.memo = 0U;
+		res = __strpdt_prog(str, &p, NULL, ep);
+		if (op != stk) {
+			free(op);
+		}
+		return res;
+	}
+}
+
+DEFUN dt_strpdt_prog_t
+dt_compile_strpdt(const char *fmt)
+{
+	struct dt_strpdt_prog_s *res;
+	struct __strpdt_op_s *op;
+	dt_dttyp_t typ;
+	size_t len;
+
+	if (fmt == NULL) {
+		/* NULL programs run __strpdt_std() */
+		return NULL;
+	}
+	typ = __trans_dtfmt(&fmt);
+	len = strlen(fmt);
+	res = malloc(sizeof(*res) + (len + 1U) * sizeof(*op));
+	if (UNLIKELY(res == NULL)) {
+		/* indistinguishable from the standard formats but for FMT */
+		errno = ENOMEM;
+		return NULL;
+	}
+	op = (void*)(res + 1U);
+	__comp_strpdt(op, fmt, len);
+	res->typ = typ;
+	res->op = op;
+	res->memo = __memo_msk(op);
+	return res;
+}
+
+DEFUN struct dt_dt_s
+dt_strpdt_run(const char *str, dt_strpdt_prog_t prog, char **ep)
+{
+	if (LIKELY(prog == NULL)) {
+		return __strpdt_std(str, ep);
+	}
+	return __strpdt_prog(str, prog, NULL, ep);
+}
+
+DEFUN void
+dt_free_strpdt(dt_strpdt_prog_t prog)
+{
+	if (prog != NULL) {
+		free(prog);
+	}
+	return;
+}
+
+DEFUN dt_strpdt_memo_t
+dt_make_strpdt_memo(void)
+{
+	return calloc(1U, sizeof(struct dt_strpdt_memo_s));
+}
+
+DEFUN struct dt_dt_s
+dt_strpdt_memo_run(
+	const char *str, dt_strpdt_prog_t prog, dt_strpdt_memo_t m,
+	char **ep)
+{
+	size_t i;
+
+	if (LIKELY(prog == NULL)) {
+		return __strpdt_std(str, ep);
+	} else if (UNLIKELY(m == NULL)) {
+		return __strpdt_prog(str, prog, NULL, ep);
+	}
+	for (i = 0U; i < MEMO_NSLOT && m->slot[i].prog != prog; i++);
+	if (UNLIKELY(i >= MEMO_NSLOT)) {
+		/* take over the next slot in turn */
+		i = m->vict++ % MEMO_NSLOT;
+		m->slot[i].prog = prog;
+		m->slot[i].npt = 0U;
+	}
+	return __strpdt_prog(str, prog, m->slot + i, ep);
+}
+
+DEFUN void
+dt_free_strpdt_memo(dt_strpdt_memo_t m)
+{
+	if (m != NULL) {
+		free(m);
+	}
+	return;
+}
+
+DEFUN size_t
+dt_strpdt_v(
+	const char *const *strs, const size_t *lens, size_t n,
+	const char *fmt, struct dt_dt_s *out, char **eps)
+{
+	dt_strpdt_prog_t p = NULL;
+	dt_strpdt_memo_t m = NULL;
+	/* \nul-terminated copies of the strings, if LENS is given */
+	char tmp[256U];
+	char *buf = tmp;
+	size_t bsz = sizeof(tmp);
+	size_t res = 0U;
+
+	if (fmt != NULL && (p = dt_compile_strpdt(fmt)) == NULL) {
+		/* out of memory, leave it to dt_strpdt() then */
+		;
+	} else if (n > 1U) {
+		/* batches tend to come in order, so share prefixes */
+		m = dt_make_strpdt_memo();
+	}
+	for (size_t i = 0U; i < n; i++) {
+		const char *s = strs[i];
+		char *e;
+
+		if (lens != NULL) {
+			if (UNLIKELY(lens[i] >= bsz)) {
+				size_t nu = (lens[i] + 1U + 255U) & ~(size_t)255U;
+				char *x = buf != tmp ? buf : NULL;
+
+				if ((x = realloc(x, nu)) == NULL) {
+					out[i] = (struct dt_dt_s){DT_UNK};
+					e = (char*)s;
+					goto ep;
+				}
+				buf = x;
+				bsz = nu;
 			}
-			if (spec.bizda) {
-				switch (*sp++) {
-				case 'B':
-					d.sd.flags.ab = BIZDA_BEFORE;
-				case 'b':
-					d.sd.flags.bizda = 1;
-					break;
-				default:
-					/* it's a bizda anyway */
-					d.sd.flags.bizda = 1;
-					sp--;
+			memcpy(buf, s, lens[i]);
+			buf[lens[i]] = '\0';
+			s = buf;
+		}
+		if (LIKELY(p != NULL || fmt == NULL)) {
+			out[i] = dt_strpdt_memo_run(s, p, m, &e);
+		} else {
+			out[i] = dt_strpdt(s, fmt, &e);
+		}
+		res += !dt_unk_p(out[i]);
+	ep:
+		if (eps != NULL) {
+			/* point into the original string */
+			eps[i] = (char*)strs[i] + (e - s);
+		}
+	}
+	if (buf != tmp) {
+		free(buf);
+	}
+	dt_free_strpdt_memo(m);
+	dt_free_strpdt(p);
+	return res;
+}
+
+/* tries of strpdt programs, common prefixes are parsed once */
+#define TRIE_MAX	(64U)
+
+struct __strpdt_node_s {
+	struct __strpdt_op_s op;
+	/* first child and next sibling, 0 for none as 0 is the root */
+	uint16_t chld;
+	uint16_t next;
+	/* program ending here, or TRIE_MAX */
+	uint8_t end;
+	/* programs in this subtree */
+	uint64_t msk;
+};
+
+struct dt_strpdt_trie_s {
+	size_t nprog;
+	/* for each program the earlier ones that might match as well */
+	uint64_t ovl[TRIE_MAX];
+	size_t nnode;
+	struct __strpdt_node_s node[];
+};
+
+struct __trie_run_s {
+	const struct dt_strpdt_trie_s *t;
+	/* programs still in the race */
+	uint64_t want;
+	size_t k;
+	struct dt_dt_s res;
+	const char *ep;
+};
+
+static inline bool
+__strpdt_op_eq(const struct __strpdt_op_s *a, const struct __strpdt_op_s *b)
+{
+	const struct dt_spec_s x = a->spec;
+	const struct dt_spec_s y = b->spec;
+
+	return a->fc == b->fc && x.spfl == y.spfl &&
+		x.ord == y.ord && x.rom == y.rom && x.tai == y.tai &&
+		x.ab == y.ab && x.bizda == y.bizda && x.abbr == y.abbr &&
+		x.pad == y.pad && x.sc12 == y.sc12 && x.cap == y.cap &&
+		x.wk_cnt == y.wk_cnt;
+}
+
+static void
+__trie_walk(
+	struct __trie_run_s *restrict r, const struct __strpdt_node_s *n,
+	struct strpdt_s d, const char *sp)
+{
+	if (n->end < TRIE_MAX && r->want >> n->end & 1U) {
+		struct dt_dt_s x = __strpdt_fini(d, false);
+
+		if (!dt_unk_p(x)) {
+			r->k = n->end;
+			r->res = x;
+			r->ep = sp;
+			/* only earlier programs can beat this one */
+			r->want &= r->t->ovl[n->end];
+		}
+	}
+	if (!*sp) {
+		/* anything longer fails */
+		return;
+	}
+	for (uint16_t c = n->chld; c && r->want; c = r->t->node[c].next) {
+		const struct __strpdt_node_s *x = r->t->node + c;
+		struct strpdt_s e = d;
+		const char *tp = sp;
+
+		if (x->msk & r->want && __strpdt_op(&e, &tp, &x->op) >= 0) {
+			__trie_walk(r, x, e, tp);
+		}
+	}
+	return;
+}
+
+DEFUN dt_strpdt_trie_t
+dt_strpdt_trie(const dt_strpdt_prog_t *prog, size_t nprog)
+{
+	struct dt_strpdt_trie_s *res;
+	size_t nnode = 1U;
+	bool shrd = false;
+
+	if (nprog < 2U || nprog > TRIE_MAX) {
+		return NULL;
+	}
+	for (size_t i = 0U; i < nprog; i++) {
+		if (prog[i] == NULL || (dt_dtyp_t)prog[i]->typ != DT_DUNK) {
+			/* standard formats and calendar names go alone */
+			return NULL;
+		}
+		for (const struct __strpdt_op_s *op = prog[i]->op;
+		     op->fc; op++, nnode++);
+	}
+	if (UNLIKELY(nnode > UINT16_MAX)) {
+		return NULL;
+	} else if ((res = malloc(
+			    sizeof(*res) + nnode * sizeof(*res->node))) == NULL) {
+		return NULL;
+	}
+	res->nprog = nprog;
+	res->nnode = 1U;
+	res->node[0U] = (struct __strpdt_node_s){.end = TRIE_MAX};
+	for (size_t i = 0U; i < nprog; i++) {
+		size_t n = 0U;
+
+		res->node[0U].msk |= 1ULL << i;
+		for (const struct __strpdt_op_s *op = prog[i]->op;
+		     op->fc; op++) {
+			uint16_t *lnk;
+
+			for (lnk = &res->node[n].chld; *lnk;
+			     lnk = &res->node[*lnk].next) {
+				if (__strpdt_op_eq(&res->node[*lnk].op, op)) {
 					break;
 				}
 			}
-		} else if (UNLIKELY(spec.rom)) {
-			if (__strpd_rom(&d.sd, sp, spec, (char**)&sp) < 0) {
-				goto fucked;
+			if (*lnk) {
+				shrd = true;
+			} else {
+				res->node[res->nnode] = (struct __strpdt_node_s){
+					.op = *op,
+					.end = TRIE_MAX,
+				};
+				*lnk = (uint16_t)res->nnode++;
 			}
+			n = *lnk;
+			res->node[n].msk |= 1ULL << i;
+		}
+		if (res->node[n].end == TRIE_MAX) {
+			res->node[n].end = (uint8_t)i;
+		} else {
+			/* duplicate, it will never win */
+			shrd = true;
 		}
 	}
-	/* check suffix literal */
-	if (!*sp && transd && *fp == 'T') {
-		/* think we just parsed the date bit */
-		goto transd;
+	if (!shrd) {
+		/* nothing to gain */
+		free(res);
+		return NULL;
 	}
-	if (*fp && *fp != *sp) {
-		goto fucked;
+	for (size_t i = 0U; i < nprog; i++) {
+		res->ovl[i] = 0U;
+		for (size_t k = 0U; k < i; k++) {
+			if (!dt_strpdt_disjoint_p(prog[k], prog[i])) {
+				res->ovl[i] |= 1ULL << k;
+			}
+		}
 	}
-	/* check if it's a sexy type */
-	if (d.i) {
-		res.typ = DT_SEXY;
-		res.sexy = d.i;
-	} else {
-	transd:
-		/* assign d and t types using date and time core routines */
-		d = massage_strpdt(d);
-		res.d = __guess_dtyp(d.sd);
-		res.t = __guess_ttyp(d.st);
+	return res;
+}
 
-		if (res.d.typ > DT_DUNK && res.t.typ > DT_TUNK) {
-			res.sandwich = 1;
-		} else if (res.d.typ > DT_DUNK) {
-			res.t.typ = DT_TUNK;
-			res.sandwich = 0;
-		} else if (res.t.typ > DT_TUNK) {
-			res.d.typ = DT_DUNK;
-			res.sandwich = 1;
+DEFUN struct dt_dt_s
+dt_strpdt_trie_run(
+	const char *str, dt_strpdt_trie_t t, uint64_t msk,
+	char **ep, size_t *which)
+{
+	struct __trie_run_s r = {
+		.t = t,
+		.want = msk,
+		.k = t->nprog,
+		.res = {DT_UNK},
+		.ep = str,
+	};
+
+	__trie_walk(&r, t->node, (struct strpdt_s){0}, str);
+	if (ep != NULL) {
+		*ep = (char*)r.ep;
+	}
+	if (which != NULL) {
+		*which = r.k;
+	}
+	return r.res;
+}
+
+DEFUN void
+dt_free_strpdt_trie(dt_strpdt_trie_t t)
+{
+	if (t != NULL) {
+		free(t);
+	}
+	return;
+}
+
+/* skeletons of strpdt programs, for disjointness checks
+ * literals are kept as is, digit specs become SK_DIG, or SK_BDIG
+ * if they overread leading blanks, \nul means we can't tell */
+#define SK_DIG		('\1')
+#define SK_BDIG		('\2')
+#define SK_MAX		(64U)
+
+static inline bool
+sk_dig_p(char c)
+{
+	return c == SK_DIG || c == SK_BDIG;
+}
+
+static inline bool
+sk_nondig_lit_p(char c)
+{
+	return c && !sk_dig_p(c) && (unsigned char)(c ^ '0') >= 10U;
+}
+
+static void
+__strpdt_skel(char sk[static SK_MAX], const struct dt_strpdt_prog_s *p)
+{
+	const struct __strpdt_op_s *op;
+	size_t n = 0U;
+
+	if ((dt_dtyp_t)p->typ != DT_DUNK) {
+		/* calendar names have their own ideas about suffixes */
+		goto out;
+	}
+	for (op = p->op; op->fc && n < SK_MAX - 6U; op++) {
+		const struct dt_spec_s s = op->spec;
+		char c;
+
+		switch (s.spfl) {
+		case DT_SPFL_UNK:
+			c = op->fc;
+			break;
+		case DT_SPFL_LIT_PERCENT:
+			c = '%';
+			break;
+		case DT_SPFL_LIT_TAB:
+			c = '\t';
+			break;
+		case DT_SPFL_LIT_NL:
+			c = '\n';
+			break;
+		case DT_SPFL_N_YEAR:
+			if (s.abbr == DT_SPMOD_ILL) {
+				/* strtoi32() allows a sign */
+				goto out;
+			}
+			/*@fallthrough@*/
+		case DT_SPFL_N_MON:
+		case DT_SPFL_N_DCNT_WEEK:
+		case DT_SPFL_N_DCNT_YEAR:
+		case DT_SPFL_N_WCNT_MON:
+		case DT_SPFL_N_HOUR:
+		case DT_SPFL_N_MIN:
+		case DT_SPFL_N_SEC:
+		case DT_SPFL_N_NANO:
+			c = SK_DIG;
+			break;
+		case DT_SPFL_N_DCNT_MON:
+			c = s.bizda ? SK_DIG : SK_BDIG;
+			break;
+		case DT_SPFL_N_TSTD:
+			/* %T is %H:%M:%S */
+			if (n && sk_dig_p(sk[n - 1U])) {
+				goto out;
+			}
+			sk[n++] = SK_DIG;
+			sk[n++] = ':';
+			sk[n++] = SK_DIG;
+			sk[n++] = ':';
+			sk[n++] = SK_DIG;
+			continue;
+		default:
+			goto out;
 		}
+		if (sk_dig_p(c)) {
+			if (s.ord || s.rom || s.bizda) {
+				/* suffixes and numerals */
+				goto out;
+			} else if (n && sk_dig_p(sk[n - 1U])) {
+				/* adjacent digit specs make one digit run,
+				 * unless blanks may sneak in between */
+				if (c == SK_BDIG) {
+					goto out;
+				}
+				continue;
+			}
+		} else if (c < ' ' && c != '\t' && c != '\n') {
+			goto out;
+		}
+		sk[n++] = c;
 	}
-	if (d.zdiff && dt_sandwich_p(res)) {
-		res = __fixup_zdiff(res, d.zdiff);
-	} else if (d.zngvn && dt_sandwich_p(res)) {
-		res.znfxd = 1;
-	}
+out:
+	sk[n] = '\0';
+	return;
+}
 
-sober:
-	/* set the end pointer */
-	if (ep != NULL) {
-		*ep = (char*)sp;
+DEFUN bool
+dt_strpdt_disjoint_p(dt_strpdt_prog_t a, dt_strpdt_prog_t b)
+{
+	char ska[SK_MAX], skb[SK_MAX];
+	const char *x, *y;
+
+	if (a == NULL || b == NULL) {
+		/* no skeletons for the standard formats */
+		return false;
 	}
-	return res;
-fucked:
-	if (ep != NULL) {
-		*ep = (char*)str;
+	__strpdt_skel(ska, a);
+	__strpdt_skel(skb, b);
+	/* both programs start at the same position and whenever a digit
+	 * run is followed by a non-digit literal it must have been read
+	 * completely, so both stay aligned until they disagree */
+	for (x = ska, y = skb; *x && *y; x++, y++) {
+		if (sk_dig_p(*x) && sk_dig_p(*y)) {
+			if (!sk_nondig_lit_p(x[1U]) || !sk_nondig_lit_p(y[1U])) {
+				return false;
+			}
+		} else if (sk_dig_p(*x) || sk_dig_p(*y)) {
+			const char d = sk_dig_p(*x) ? *x : *y;
+			const char l = sk_dig_p(*x) ? *y : *x;
+
+			/* digits v literal, blanks may be overread though */
+			return sk_nondig_lit_p(l) && !(d == SK_BDIG && l == ' ');
+		} else if (*x != *y) {
+			return true;
+		}
 	}
-	return (struct dt_dt_s){DT_UNK};
+	return false;
 }
 
-DEFUN size_t
-dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
+/* fields __strfdt_prep() is to compute */
+#define STRFDT_NEED_D		(1U)
+#define STRFDT_NEED_Z		(2U)
+#define STRFDT_NEED_MILF	(4U)
+
+static const char*
+__strfdt_fmt(const char *fmt, struct dt_dt_s *restrict that, bool *xdnp)
 {
-	struct strpdt_s d = {0};
-	const char *fp;
-	char *bp;
+/* resolve FMT for THAT, converting THAT if FMT names a calendar,
+ * set *XDNP if THAT is to be printed by __strfdt_xdn() instead */
 	dt_dtyp_t tgttyp;
 	int set_fmt = 0;
 
-	if (UNLIKELY(buf == NULL || bsz == 0)) {
-		bp = buf;
-		goto out;
-	}
-
 	if (LIKELY(fmt == NULL)) {
 		/* um, great */
 		set_fmt = 1;
@@ -816,12 +1491,12 @@ dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
 		/* don't worry about it */
 		;
 	} else if ((tgttyp = __trans_dfmt_special(fmt)) != (dt_dtyp_t)DT_UNK) {
-		that = dt_dtconv((dt_dttyp_t)tgttyp, that);
+		*that = dt_dtconv((dt_dttyp_t)tgttyp, *that);
 		set_fmt = 1;
 	}
 
-	if (set_fmt && dt_sandwich_p(that)) {
-		switch (that.typ) {
+	if (set_fmt && dt_sandwich_p(*that)) {
+		switch (that->typ) {
 		case DT_YMD:
 			fmt = ymdhms_dflt;
 			break;
@@ -842,9 +1517,9 @@ dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
 		case DT_LDN:
 		case DT_MDN:
 		strf_xian:
-			/* short cut, just print the guy here */
-			bp = buf + __strfdt_xdn(buf, bsz, that);
-			goto out;
+			/* short cut, just print the guy */
+			*xdnp = true;
+			break;
 		case DT_BIZDA:
 			fmt = bizdahms_dflt;
 			break;
@@ -861,8 +1536,8 @@ dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
 			abort();
 			break;
 		}
-	} else if (set_fmt && dt_sandwich_only_d_p(that)) {
-		switch (that.d.typ) {
+	} else if (set_fmt && dt_sandwich_only_d_p(*that)) {
+		switch (that->d.typ) {
 		case DT_YMD:
 			fmt = ymd_dflt;
 			break;
@@ -895,131 +1570,735 @@ dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
 			abort();
 			break;
 		}
-	} else if (set_fmt && that.typ >= DT_PACK && that.typ < DT_NDTTYP) {
+	} else if (set_fmt && that->typ >= DT_PACK && that->typ < DT_NDTTYP) {
 		/* must be sexy or ymdhms */
 		fmt = ymdhms_dflt;
-	} else if (dt_sandwich_only_t_p(that)) {
+	} else if (dt_sandwich_only_t_p(*that)) {
 		/* transform time specs */
 		__trans_tfmt(&fmt);
 	}
+	return fmt;
+}
 
+static bool
+__strfdt_prep(
+	struct strpdt_s *restrict d, struct dt_dt_s *restrict that,
+	unsigned int need)
+{
+/* fill D with the fields of THAT selected by NEED,
+ * return false if there's nothing to print */
 	/* fix up before printing */
-	if (LIKELY(dt_sandwich_p(that) || dt_sandwich_only_d_p(that))) {
-		that.d = dt_dfixup(that.d);
+	if ((need & STRFDT_NEED_D) &&
+	    LIKELY(dt_sandwich_p(*that) || dt_sandwich_only_d_p(*that))) {
+		that->d = dt_dfixup(that->d);
+	}
+	if (need & STRFDT_NEED_Z) {
+		d->zdiff = zdiff_sec(*that);
 	}
-	/* make sure we always snarf the zdiff info */
-	d.zdiff = zdiff_sec(that);
 
-	if (dt_sandwich_p(that) && UNLIKELY(that.t.hms.h == 24U)) {
-		/* military midnight fixup
-		 * only when there's %H or %T in the flags, don't decay*/
-		if (need_milfup_p(fmt)) {
-			that = dt_milfup(that);
-		}
+	if ((need & STRFDT_NEED_MILF) &&
+	    dt_sandwich_p(*that) && UNLIKELY(that->t.hms.h == 24U)) {
+		/* military midnight fixup */
+		*that = dt_milfup(*that);
 	}
 
-	switch (that.typ) {
+	switch (that->typ) {
 	case DT_YMD:
 	case DT_UMMULQURA:
 	ymd_prep:
-		d.sd.y = that.d.ymd.y;
-		d.sd.m = that.d.ymd.m;
-		d.sd.d = that.d.ymd.d;
+		d->sd.y = that->d.ymd.y;
+		d->sd.m = that->d.ymd.m;
+		d->sd.d = that->d.ymd.d;
 		break;
 	case DT_YMCW:
-		d.sd.y = that.d.ymcw.y;
-		d.sd.m = that.d.ymcw.m;
-		d.sd.c = that.d.ymcw.c;
-		d.sd.w = that.d.ymcw.w;
+		d->sd.y = that->d.ymcw.y;
+		d->sd.m = that->d.ymcw.m;
+		d->sd.c = that->d.ymcw.c;
+		d->sd.w = that->d.ymcw.w;
 		break;
 	case DT_YWD:
-		__prep_strfd_ywd(&d.sd, that.d.ywd);
+		if (need & STRFDT_NEED_D) {
+			__prep_strfd_ywd(&d->sd, that->d.ywd);
+		}
 		break;
 	case DT_YD:
-		d.sd.y = that.d.yd.y;
-		d.sd.d = that.d.yd.d;
-		d.sd.flags.d_dcnt_p = 1U;
+		d->sd.y = that->d.yd.y;
+		d->sd.d = that->d.yd.d;
+		d->sd.flags.d_dcnt_p = 1U;
 		break;
 	case DT_JDN:
-		that = dt_dtconv((dt_dttyp_t)DT_DAISY, that);
+		*that = dt_dtconv((dt_dttyp_t)DT_DAISY, *that);
 		goto daisy_prep;
 	case DT_LDN:
-		that = dt_dtconv((dt_dttyp_t)DT_DAISY, that);
+		*that = dt_dtconv((dt_dttyp_t)DT_DAISY, *that);
 		goto daisy_prep;
 	case DT_MDN:
-		that = dt_dtconv((dt_dttyp_t)DT_DAISY, that);
+		*that = dt_dtconv((dt_dttyp_t)DT_DAISY, *that);
 		goto daisy_prep;
 	case DT_DAISY:
 	daisy_prep:
-		__prep_strfd_daisy(&d.sd, that.d.daisy);
+		if (need & STRFDT_NEED_D) {
+			__prep_strfd_daisy(&d->sd, that->d.daisy);
+		}
 		break;
 
 	case DT_BIZDA:
 		__prep_strfd_bizda(
-			&d.sd, that.d.bizda, __get_bizda_param(that.d));
+			&d->sd, that->d.bizda, __get_bizda_param(that->d));
 		break;
 
 	case DT_SEXY:
 		/* instead of leaving this as SEXY turn it into
 		 * DAISY/HMS sandwich */
-		that = dt_dtconv((dt_dttyp_t)DT_DAISY, that);
+		*that = dt_dtconv((dt_dttyp_t)DT_DAISY, *that);
 		/* prep d.sd */
 		goto daisy_prep;
 	case DT_YMDHMS:
 		/* convert this to a YMD/HMS sandwich */
-		that = dt_dtconv((dt_dttyp_t)DT_YMD, that);
+		*that = dt_dtconv((dt_dttyp_t)DT_YMD, *that);
 		/* prep d.sd */
 		goto ymd_prep;
 
 	default:
 	case DT_DUNK:
-		if (!dt_sandwich_only_t_p(that)) {
-			bp = buf;
-			goto out;
+		if (!dt_sandwich_only_t_p(*that)) {
+			return false;
 		}
 	}
 
-	if (dt_sandwich_p(that) || dt_sandwich_only_t_p(that)) {
+	if (dt_sandwich_p(*that) || dt_sandwich_only_t_p(*that)) {
 		/* cope with the time part */
-		d.st.h = that.t.hms.h;
-		d.st.m = that.t.hms.m;
-		d.st.s = that.t.hms.s;
-		d.st.ns = that.t.hms.ns;
+		d->st.h = that->t.hms.h;
+		d->st.m = that->t.hms.m;
+		d->st.s = that->t.hms.s;
+		d->st.ns = that->t.hms.ns;
+	}
+	return true;
+}
+
+static inline char*
+__strfdt_op(
+	char *bp, char *const eo, struct dt_spec_s spec, char fc,
+	struct strpdt_s *restrict d, struct dt_dt_s that)
+{
+/* print spec SPEC, or literal FC, of D/THAT to BP, return the new BP */
+	if (spec.spfl == DT_SPFL_UNK) {
+		/* must be literal then */
+		*bp++ = fc;
+	} else if (LIKELY(!spec.rom)) {
+		bp += __strfdt_card(bp, eo - bp, spec, d, that);
+		if (spec.ord) {
+			bp += __ordtostr(bp, eo - bp);
+		} else if (spec.bizda) {
+			/* don't print the b after an ordinal */
+			if (spec.ab == BIZDA_AFTER) {
+				*bp++ = 'b';
+			} else {
+				*bp++ = 'B';
+			}
+		}
+	} else if (UNLIKELY(spec.rom)) {
+		bp += __strfd_rom(bp, eo - bp, spec, &d->sd, that.d);
 	}
+	return bp;
+}
 
-	/* assign and go */
-	bp = buf;
-	fp = fmt;
-	for (char *const eo = buf + bsz; *fp && bp < eo;) {
+static char*
+__strfdt_fmt_run(
+	char *bp, char *const eo, const char *fmt,
+	struct strpdt_s *restrict d, struct dt_dt_s that)
+{
+	for (const char *fp = fmt; *fp && bp < eo;) {
 		const char *fp_sav = fp;
 		struct dt_spec_s spec = __tok_spec(fp_sav, &fp);
 
-		if (spec.spfl == DT_SPFL_UNK) {
-			/* must be literal then */
-			*bp++ = *fp_sav;
-		} else if (LIKELY(!spec.rom)) {
-			bp += __strfdt_card(bp, eo - bp, spec, &d, that);
-			if (spec.ord) {
-				bp += __ordtostr(bp, eo - bp);
-			} else if (spec.bizda) {
-				/* don't print the b after an ordinal */
-				if (spec.ab == BIZDA_AFTER) {
-					*bp++ = 'b';
-				} else {
-					*bp++ = 'B';
-				}
+		bp = __strfdt_op(bp, eo, spec, *fp_sav, d, that);
+	}
+	return bp;
+}
+
+DEFUN size_t
+dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s that)
+{
+	struct strpdt_s d = {0};
+	unsigned int need = STRFDT_NEED_D | STRFDT_NEED_Z;
+	bool xdnp = false;
+	char *bp = buf;
+
+	if (UNLIKELY(buf == NULL || bsz == 0)) {
+		goto out;
+	}
+
+	fmt = __strfdt_fmt(fmt, &that, &xdnp);
+	if (UNLIKELY(xdnp)) {
+		bp += __strfdt_xdn(buf, bsz, that);
+		goto out;
+	}
+	/* military midnights need decaying unless there's %H or %T */
+	if (dt_sandwich_p(that) && UNLIKELY(that.t.hms.h == 24U) &&
+	    need_milfup_p(fmt)) {
+		need |= STRFDT_NEED_MILF;
+	}
+	if (!__strfdt_prep(&d, &that, need)) {
+		goto out;
+	}
+	/* assign and go */
+	bp = __strfdt_fmt_run(buf, buf + bsz, fmt, &d, that);
+out:
+	if (bp < buf + bsz) {
+		*bp = '\0';
+	}
+	return bp - buf;
+}
+
+/* formatter programs */
+struct __strfdt_ent_s {
+	/* what __strfdt_fmt() resolves to, compared by address */
+	const char *fmt;
+	const struct __strpdt_op_s *op;
+	unsigned int need;
+	/* ISO 8601 shape of the ops, and their separators */
+	unsigned int iso;
+	char tsep;
+	char nsep;
+	/* number of leading ops that depend on the date alone, and on the
+	 * date, hour and minute, what the ops past them need and the ISO
+	 * shape of the ops past the date */
+	unsigned int kd;
+	unsigned int khm;
+	unsigned int need_d;
+	unsigned int need_hm;
+	unsigned int iso_d;
+};
+
+struct dt_strfdt_prog_s {
+	const char *fmt;
+	size_t nent;
+	struct __strfdt_ent_s ent[];
+};
+
+/* formatter memos, the output of the date and hour/minute prefixes of
+ * the last date/time printed with an entry, only used with buffers of
+ * at least twice the prefix limit, so that no prefix op ran short */
+#define STRFDT_MEMO_MAX		(64U)
+#define STRFDT_MEMO_NSLOT	(4U)
+
+struct __strfdt_memo_slot_s {
+	const struct __strfdt_ent_s *e;
+	/* date part, zone difference included, and hour/minute */
+	uint64_t d;
+	unsigned int hm;
+	uint8_t zd;
+	uint8_t zhm;
+	char pfx[STRFDT_MEMO_MAX];
+};
+
+struct dt_strfdt_memo_s {
+	unsigned int vict;
+	struct __strfdt_memo_slot_s slot[STRFDT_MEMO_NSLOT];
+};
+
+static unsigned int
+__strfdt_need(const struct __strpdt_op_s *op)
+{
+/* fields __strfdt_prep() must compute for the ops OP */
+	unsigned int res = 0U;
+
+	for (; op->fc; op++) {
+		switch (op->spec.spfl) {
+		case DT_SPFL_UNK:
+		case DT_SPFL_LIT_PERCENT:
+		case DT_SPFL_LIT_TAB:
+		case DT_SPFL_LIT_NL:
+		case DT_SPFL_N_TSTD:
+		case DT_SPFL_N_HOUR:
+		case DT_SPFL_N_MIN:
+		case DT_SPFL_N_SEC:
+		case DT_SPFL_S_AMPM:
+		case DT_SPFL_N_NANO:
+			break;
+		case DT_SPFL_N_ZDIFF:
+			res |= STRFDT_NEED_Z;
+			break;
+		default:
+			res |= STRFDT_NEED_D;
+			break;
+		}
+	}
+	return res;
+}
+
+/* ISO 8601 shapes, %F, %T, %N after a separator, and %Z */
+#define STRFDT_ISO_D		(1U)
+#define STRFDT_ISO_T		(2U)
+#define STRFDT_ISO_N		(4U)
+#define STRFDT_ISO_Z		(8U)
+/* room __strfdt_iso() needs, with its overlapping stores */
+#define STRFDT_ISO_ROOM		(40)
+
+static inline bool
+__strfdt_plain_p(const struct __strpdt_op_s *op, dt_spfl_t spfl)
+{
+	return op->spec.spfl == spfl &&
+		!op->spec.ord && !op->spec.bizda && !op->spec.rom;
+}
+
+static void
+__strfdt_iso_shape(
+	struct __strfdt_ent_s *restrict e, const struct __strpdt_op_s *op)
+{
+/* set E's ISO shape if OP is %F[c%T[c%N]][%Z] or %T[c%N][%Z] */
+	unsigned int iso = 0U;
+
+	if (__strfdt_plain_p(op, DT_SPFL_N_DSTD)) {
+		iso |= STRFDT_ISO_D;
+		op++;
+		if (op->spec.spfl == DT_SPFL_UNK && op->fc &&
+		    __strfdt_plain_p(op + 1, DT_SPFL_N_TSTD)) {
+			e->tsep = op->fc;
+			iso |= STRFDT_ISO_T;
+			op += 2;
+		}
+	} else if (__strfdt_plain_p(op, DT_SPFL_N_TSTD)) {
+		iso |= STRFDT_ISO_T;
+		op++;
+	} else {
+		return;
+	}
+	if ((iso & STRFDT_ISO_T) &&
+	    op->spec.spfl == DT_SPFL_UNK && op->fc &&
+	    __strfdt_plain_p(op + 1, DT_SPFL_N_NANO)) {
+		e->nsep = op->fc;
+		iso |= STRFDT_ISO_N;
+		op += 2;
+	}
+	if (__strfdt_plain_p(op, DT_SPFL_N_ZDIFF)) {
+		iso |= STRFDT_ISO_Z;
+		op++;
+	}
+	if (op->fc == '\0') {
+		e->iso = iso;
+	}
+	return;
+}
+
+/* digit pairs 00 to 99 */
+static const char dig99[200U] =
+	"00010203040506070809" "10111213141516171819"
+	"20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859"
+	"60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
+
+static inline uint64_t
+__dig2(unsigned int x, unsigned int at)
+{
+/* digit pair of X < 100 as bytes AT and AT + 1 of a little-endian word */
+	const unsigned char *p = (const unsigned char*)dig99 + 2U * x;
+
+	return ((uint64_t)p[0U] | (uint64_t)p[1U] << 8U) << (8U * at);
+}
+
+static inline uint64_t
+__chr(char c, unsigned int at)
+{
+	return (uint64_t)(unsigned char)c << (8U * at);
+}
+
+static inline void
+__stw(char *p, uint64_t w)
+{
+	w = htole64(w);
+	memcpy(p, &w, sizeof(w));
+	return;
+}
+
+static inline bool
+__strfdt_iso_p(unsigned int iso, const struct strpdt_s *d)
+{
+/* whether D's fields print in fixed width, as __strfdt_card() would */
+	if ((iso & STRFDT_ISO_D) &&
+	    ((unsigned int)d->sd.y > 9999U ||
+	     (unsigned int)d->sd.m - 1U >= 99U ||
+	     (unsigned int)d->sd.d - 1U >= 99U)) {
+		return false;
+	}
+	if ((iso & STRFDT_ISO_T) &&
+	    ((unsigned int)d->st.h > 99U ||
+	     (unsigned int)d->st.m > 99U ||
+	     (unsigned int)d->st.s > 99U)) {
+		return false;
+	}
+	if ((iso & STRFDT_ISO_N) && (unsigned int)d->st.ns > 999999999U) {
+		return false;
+	}
+	if ((iso & STRFDT_ISO_Z) &&
+	    (d->zdiff <= -100 * 3600 || d->zdiff >= 100 * 3600)) {
+		return false;
+	}
+	return true;
+}
+
+static char*
+__strfdt_iso(char *restrict bp, const struct __strfdt_ent_s *e,
+	     unsigned int iso, const struct strpdt_s *d)
+{
+/* print D in ISO shape ISO, with E's separators, to BP, in whole words
+ * that may spill over into the bytes of the next field,
+ * return the new BP */
+	if (iso & STRFDT_ISO_D) {
+		const unsigned int y = d->sd.y;
+
+		__stw(bp, __dig2(y / 100U, 0U) | __dig2(y % 100U, 2U) |
+		      __chr('-', 4U) | __dig2(d->sd.m, 5U) | __chr('-', 7U));
+		__stw(bp + 8U, __dig2(d->sd.d, 0U) | __chr(e->tsep, 2U));
+		bp += 10U + !!(iso & STRFDT_ISO_T);
+	}
+	if (iso & STRFDT_ISO_T) {
+		__stw(bp, __dig2(d->st.h, 0U) | __chr(':', 2U) |
+		      __dig2(d->st.m, 3U) | __chr(':', 5U) |
+		      __dig2(d->st.s, 6U));
+		bp += 8U;
+	}
+	if (iso & STRFDT_ISO_N) {
+		const unsigned int ns = d->st.ns;
+		const unsigned int x = ns / 10U;
+
+		*bp = e->nsep;
+		__stw(bp + 1U,
+		      __dig2(x / 1000000U, 0U) |
+		      __dig2(x / 10000U % 100U, 2U) |
+		      __dig2(x / 100U % 100U, 4U) |
+		      __dig2(x % 100U, 6U));
+		bp[9U] = (char)('0' + ns % 10U);
+		bp += 10U;
+	}
+	if (iso & STRFDT_ISO_Z) {
+		unsigned int z = d->zdiff;
+		char sign = '+';
+
+		if (d->zdiff < 0) {
+			z = -d->zdiff;
+			sign = '-';
+		}
+		__stw(bp, __chr(sign, 0U) | __dig2(z / 3600U, 1U) |
+		      __chr(':', 3U) | __dig2(z / 60U % 60U, 4U));
+		bp += 6U;
+	}
+	return bp;
+}
+
+/* what an op's output depends on, besides literals */
+#define STRFDT_DEP_D		(1U)
+#define STRFDT_DEP_HM		(2U)
+#define STRFDT_DEP_REST		(4U)
+
+static unsigned int
+__strfdt_dep(struct dt_spec_s spec)
+{
+	switch (spec.spfl) {
+	case DT_SPFL_UNK:
+	case DT_SPFL_LIT_PERCENT:
+	case DT_SPFL_LIT_TAB:
+	case DT_SPFL_LIT_NL:
+		return 0U;
+	case DT_SPFL_N_DSTD:
+	case DT_SPFL_N_YEAR:
+	case DT_SPFL_N_MON:
+	case DT_SPFL_N_DCNT_WEEK:
+	case DT_SPFL_N_DCNT_MON:
+	case DT_SPFL_N_DCNT_YEAR:
+	case DT_SPFL_N_WCNT_MON:
+	case DT_SPFL_N_WCNT_YEAR:
+	case DT_SPFL_S_WDAY:
+	case DT_SPFL_S_MON:
+	case DT_SPFL_S_QTR:
+	case DT_SPFL_N_QTR:
+	case DT_SPFL_N_ZDIFF:
+		/* the zone difference lives next to the date */
+		return STRFDT_DEP_D;
+	case DT_SPFL_N_HOUR:
+	case DT_SPFL_N_MIN:
+	case DT_SPFL_S_AMPM:
+		return STRFDT_DEP_HM;
+	default:
+		return STRFDT_DEP_REST;
+	}
+}
+
+static void
+__strfdt_pfx(struct __strfdt_ent_s *restrict e, const struct __strpdt_op_s *op)
+{
+/* find E's date and hour/minute prefixes, for memos,
+ * those are never used on military midnights */
+	const struct __strpdt_op_s *o = op;
+
+	for (; o->fc && !(__strfdt_dep(o->spec) & ~STRFDT_DEP_D); o++);
+	e->kd = o - op;
+	e->need_d = __strfdt_need(o);
+	for (; o->fc && !(__strfdt_dep(o->spec) & STRFDT_DEP_REST); o++);
+	e->khm = o - op;
+	e->need_hm = __strfdt_need(o);
+	/* with %T the date prefix ends in the separator */
+	e->iso_d = e->iso & STRFDT_ISO_T
+		? e->iso & ~STRFDT_ISO_D : 0U;
+	return;
+}
+
+DEFUN dt_strfdt_prog_t
+dt_compile_strfdt(const char *fmt)
+{
+	/* formats FMT might resolve to, FMT itself goes first */
+	const char *cand[16U];
+	size_t ncand = 0U;
+	struct dt_strfdt_prog_s *res;
+	struct __strpdt_op_s *op;
+	size_t len = 0U;
+
+	if (fmt != NULL) {
+		cand[ncand++] = fmt;
+	}
+	if (fmt == NULL || (*fmt != '%' &&
+			    __trans_dfmt_special(fmt) != (dt_dtyp_t)DT_UNK)) {
+		/* calendar defaults */
+		cand[ncand++] = ymdhms_dflt;
+		cand[ncand++] = ymcwhms_dflt;
+		cand[ncand++] = ywdhms_dflt;
+		cand[ncand++] = ydhms_dflt;
+		cand[ncand++] = bizdahms_dflt;
+		cand[ncand++] = ymd_dflt;
+		cand[ncand++] = ymcw_dflt;
+		cand[ncand++] = ywd_dflt;
+		cand[ncand++] = yd_dflt;
+		cand[ncand++] = bizda_dflt;
+	}
+	with (const char *tfmt = fmt) {
+		/* and what time-only date/times make of it */
+		__trans_tfmt(&tfmt);
+		if (tfmt != fmt) {
+			cand[ncand++] = tfmt;
+		}
+	}
+
+	for (size_t i = 0U; i < ncand; i++) {
+		len += strlen(cand[i]) + 1U;
+	}
+	res = malloc(sizeof(*res) + ncand * sizeof(*res->ent) +
+		     len * sizeof(*op));
+	if (UNLIKELY(res == NULL)) {
+		return NULL;
+	}
+	res->fmt = fmt;
+	res->nent = ncand;
+	op = (void*)(res->ent + ncand);
+	for (size_t i = 0U; i < ncand; i++) {
+		const size_t z = strlen(cand[i]);
+
+		__comp_strpdt(op, cand[i], z);
+		res->ent[i].fmt = cand[i];
+		res->ent[i].op = op;
+		res->ent[i].need = __strfdt_need(op);
+		if (need_milfup_p(cand[i])) {
+			/* decaying moves the date */
+			res->ent[i].need |= STRFDT_NEED_MILF | STRFDT_NEED_D;
+		}
+		res->ent[i].iso = 0U;
+		__strfdt_iso_shape(res->ent + i, op);
+		__strfdt_pfx(res->ent + i, op);
+		op += z + 1U;
+	}
+	return res;
+}
+
+static size_t
+__strfdt_prog(
+	char *restrict buf, size_t bsz, dt_strfdt_prog_t prog,
+	dt_strfdt_memo_t m, struct dt_dt_s that)
+{
+	struct strpdt_s d = {0};
+	const struct __strfdt_ent_s *e, *const ee = prog->ent + prog->nent;
+	struct __strfdt_memo_slot_s *x = NULL;
+	const struct __strpdt_op_s *op;
+	struct dt_dt_s this = that;
+	char *const eo = buf + bsz;
+	size_t zd = SIZE_MAX, zhm = SIZE_MAX;
+	unsigned int hm = 0U;
+	uint64_t dk = 0U;
+	const char *fmt;
+	bool xdnp = false;
+	char *bp = buf;
+
+	if (UNLIKELY(buf == NULL || bsz == 0)) {
+		goto out;
+	}
+
+	fmt = __strfdt_fmt(prog->fmt, &this, &xdnp);
+	if (UNLIKELY(xdnp)) {
+		bp += __strfdt_xdn(buf, bsz, this);
+		goto out;
+	}
+	for (e = prog->ent; e < ee && e->fmt != fmt; e++);
+	if (UNLIKELY(e >= ee)) {
+		/* not one of ours, interpret it then */
+		return dt_strfdt(buf, bsz, prog->fmt, that);
+	}
+	if (m != NULL && e->kd && bsz >= 2U * STRFDT_MEMO_MAX &&
+	    (dt_sandwich_only_d_p(this) ||
+	     (dt_sandwich_p(this) && this.t.hms.h != 24U))) {
+		size_t i;
+
+		memcpy(&dk, &this.d, sizeof(dk));
+		if (dt_sandwich_p(this)) {
+			hm = this.t.hms.h << 8U | this.t.hms.m;
+		}
+		for (i = 0U; i < STRFDT_MEMO_NSLOT && m->slot[i].e != e; i++);
+		if (UNLIKELY(i >= STRFDT_MEMO_NSLOT)) {
+			/* take over the next slot in turn */
+			i = m->vict++ % STRFDT_MEMO_NSLOT;
+			m->slot[i].e = e;
+			m->slot[i].zhm = 0U;
+		} else if (m->slot[i].zhm && m->slot[i].d == dk) {
+			/* splice in the prefix and print the rest */
+			const bool hmp = m->slot[i].hm == hm;
+			const size_t z = hmp ? m->slot[i].zhm : m->slot[i].zd;
+
+			/* whole prefix buffers copy faster than Z bytes */
+			memcpy(buf, m->slot[i].pfx, STRFDT_MEMO_MAX);
+			bp = buf + z;
+			op = e->op + (hmp ? e->khm : e->kd);
+			(void)__strfdt_prep(
+				&d, &this, hmp ? e->need_hm : e->need_d);
+			if (e->iso_d && eo - bp >= STRFDT_ISO_ROOM &&
+			    __strfdt_iso_p(e->iso_d, &d)) {
+				bp = __strfdt_iso(bp, e, e->iso_d, &d);
+				goto out;
+			}
+			goto rest;
+		}
+		x = m->slot + i;
+	}
+	if (!__strfdt_prep(&d, &this, e->need)) {
+		goto out;
+	}
+	if (e->iso && eo - bp >= STRFDT_ISO_ROOM &&
+	    __strfdt_iso_p(e->iso, &d)) {
+		bp = __strfdt_iso(bp, e, e->iso, &d);
+		if (e->iso_d) {
+			/* date, separator */
+			zd = zhm = 11U;
+		}
+		goto memo;
+	}
+	/* straight through the ops */
+	for (op = e->op; op->fc && bp < eo; op++) {
+		if (UNLIKELY(x != NULL)) {
+			if (op - e->op == e->kd) {
+				zd = bp - buf;
 			}
-		} else if (UNLIKELY(spec.rom)) {
-			bp += __strfd_rom(bp, eo - bp, spec, &d.sd, that.d);
+			if (op - e->op == e->khm) {
+				zhm = bp - buf;
+			}
+		}
+		bp = __strfdt_op(bp, eo, op->spec, op->fc, &d, this);
+	}
+memo:
+	if (x != NULL && bp < eo) {
+		/* ops past the end start at the end */
+		zd = zd < SIZE_MAX ? zd : (size_t)(bp - buf);
+		zhm = zhm < SIZE_MAX ? zhm : (size_t)(bp - buf);
+		if (zhm && zhm <= STRFDT_MEMO_MAX) {
+			memcpy(x->pfx, buf, STRFDT_MEMO_MAX);
+			x->d = dk;
+			x->hm = hm;
+			x->zd = (uint8_t)zd;
+			x->zhm = (uint8_t)zhm;
+		} else {
+			x->zhm = 0U;
 		}
 	}
+	goto out;
+rest:
+	for (; op->fc && bp < eo; op++) {
+		bp = __strfdt_op(bp, eo, op->spec, op->fc, &d, this);
+	}
 out:
-	if (bp < buf + bsz) {
+	if (bp < eo) {
 		*bp = '\0';
 	}
 	return bp - buf;
 }
 
+DEFUN size_t
+dt_strfdt_run(
+	char *restrict buf, size_t bsz, dt_strfdt_prog_t prog,
+	struct dt_dt_s that)
+{
+	return __strfdt_prog(buf, bsz, prog, NULL, that);
+}
+
+DEFUN dt_strfdt_memo_t
+dt_make_strfdt_memo(void)
+{
+	return calloc(1U, sizeof(struct dt_strfdt_memo_s));
+}
+
+DEFUN size_t
+dt_strfdt_memo_run(
+	char *restrict buf, size_t bsz, dt_strfdt_prog_t prog,
+	dt_strfdt_memo_t m, struct dt_dt_s that)
+{
+	return __strfdt_prog(buf, bsz, prog, m, that);
+}
+
+DEFUN void
+dt_free_strfdt_memo(dt_strfdt_memo_t m)
+{
+	if (m != NULL) {
+		free(m);
+	}
+	return;
+}
+
+DEFUN void
+dt_free_strfdt(dt_strfdt_prog_t prog)
+{
+	if (prog != NULL) {
+		free(prog);
+	}
+	return;
+}
+
+DEFUN size_t
+dt_strfdt_v(
+	char *restrict buf, size_t bsz, const char *fmt,
+	const struct dt_dt_s *dts, size_t n, size_t *lens)
+{
+	dt_strfdt_prog_t p = NULL;
+	size_t i;
+
+	if (n > 1U) {
+		/* worth compiling, NULL means we interpret FMT */
+		p = dt_compile_strfdt(fmt);
+	}
+	for (i = 0U; i < n; i++) {
+		size_t z = LIKELY(p != NULL)
+			? dt_strfdt_run(buf, bsz, p, dts[i])
+			: dt_strfdt(buf, bsz, fmt, dts[i]);
+
+		if (z >= bsz) {
+			/* no room for the \nul, so it's been cut short */
+			break;
+		}
+		if (lens != NULL) {
+			lens[i] = z;
+		}
+		buf += z + 1U;
+		bsz -= z + 1U;
+	}
+	dt_free_strfdt(p);
+	return i;
+}
+
 DEFUN struct dt_dtdur_s
 dt_strpdtdur(const char *str, char **ep)
 {
@@ -110,6 +110,14 @@ typedef int64_t dt_sexy_t;
 typedef int64_t dt_ssexy_t;
 #define DT_SEXY_BASE_YEAR	(1917)
 
+/** strpdt programs, compiled input formats */
+typedef struct dt_strpdt_prog_s *dt_strpdt_prog_t;
+typedef struct dt_strpdt_trie_s *dt_strpdt_trie_t;
+typedef struct dt_strpdt_memo_s *dt_strpdt_memo_t;
+/** strfdt programs, compiled output formats */
+typedef struct dt_strfdt_prog_s *dt_strfdt_prog_t;
+typedef struct dt_strfdt_memo_s *dt_strfdt_memo_t;
+
 struct dt_dt_s {
 	union {
 		/* packs */
@@ -234,11 +242,143 @@ struct dt_dtdur_s {
 extern struct dt_dt_s
 dt_strpdt(const char *str, const char *fmt, char **ep);
 
+/**
+ * Compile FMT, as understood by dt_strpdt(), for repeated use with
+ * dt_strpdt_run().  A NULL FMT yields the NULL program which stands for
+ * the standard formats.
+ * For non-NULL FMT a NULL result means the allocation failed and errno
+ * is set to ENOMEM, it must not be run in place of FMT then.
+ * Programs are immutable and can be shared among threads, free them
+ * with dt_free_strpdt(). */
+extern dt_strpdt_prog_t dt_compile_strpdt(const char *fmt);
+
+/**
+ * Like dt_strpdt() but with a format compiled by dt_compile_strpdt(). */
+extern struct dt_dt_s
+dt_strpdt_run(const char *str, dt_strpdt_prog_t prog, char **ep);
+
+/**
+ * Free a program obtained by dt_compile_strpdt(). */
+extern void dt_free_strpdt(dt_strpdt_prog_t);
+
+/**
+ * Obtain an empty memo for dt_strpdt_memo_run(), or NULL.
+ * Memos are not to be shared among threads and must not outlive the
+ * programs they have been used with, free them with
+ * dt_free_strpdt_memo(). */
+extern dt_strpdt_memo_t dt_make_strpdt_memo(void);
+
+/**
+ * Like dt_strpdt_run() but remember in M where the numeric fields of a
+ * successfully parsed STR began, so that a later STR starting with the
+ * same bytes as this one, up to one of those fields, is parsed from
+ * that field on. */
+extern struct dt_dt_s
+dt_strpdt_memo_run(
+	const char *str, dt_strpdt_prog_t prog, dt_strpdt_memo_t m,
+	char **ep);
+
+/**
+ * Free a memo obtained by dt_make_strpdt_memo(). */
+extern void dt_free_strpdt_memo(dt_strpdt_memo_t);
+
+/**
+ * Parse the N strings STRS with FMT, as understood by dt_strpdt(), into
+ * OUT, compiling FMT only once.
+ * If LENS is non-NULL the I-th string consists of LENS[I] bytes and
+ * need not be \nul-terminated, otherwise all strings must be.
+ * If EPS is non-NULL EPS[I] is set to the end of the date/time parsed
+ * from STRS[I], or to STRS[I] if there was none.
+ * Return the number of strings that could be parsed. */
+extern size_t
+dt_strpdt_v(
+	const char *const *strs, const size_t *lens, size_t n,
+	const char *fmt, struct dt_dt_s *out, char **eps);
+
+/**
+ * Combine the NPROG programs PROG into a trie over their specifiers so
+ * that common prefixes are parsed only once.
+ * Return NULL if there is nothing to share, if there are more than 64
+ * programs, or if PROG contains NULL programs or calendar names. */
+extern dt_strpdt_trie_t
+dt_strpdt_trie(const dt_strpdt_prog_t *prog, size_t nprog);
+
+/**
+ * Like trying the programs of T selected by bit set MSK one after
+ * another with dt_strpdt_run() until one succeeds.
+ * If non-NULL, WHICH is set to the index of that program, or to the
+ * number of programs if none succeeded. */
+extern struct dt_dt_s
+dt_strpdt_trie_run(
+	const char *str, dt_strpdt_trie_t t, uint64_t msk,
+	char **ep, size_t *which);
+
+/**
+ * Free a trie obtained by dt_strpdt_trie(). */
+extern void dt_free_strpdt_trie(dt_strpdt_trie_t);
+
+/**
+ * Return true if no string can be parsed by both A and B.
+ * This is conservative, false means they might overlap. */
+extern bool dt_strpdt_disjoint_p(dt_strpdt_prog_t a, dt_strpdt_prog_t b);
+
 /**
  * Like strftime() for our dates */
 extern size_t
 dt_strfdt(char *restrict buf, size_t bsz, const char *fmt, struct dt_dt_s);
 
+/**
+ * Compile FMT, as understood by dt_strfdt(), for repeated use with
+ * dt_strfdt_run().  This includes the default formats a NULL FMT or a
+ * calendar name would resolve to, and which fields they print.
+ * Return NULL if allocation failed.
+ * Programs are immutable and can be shared among threads, free them
+ * with dt_free_strfdt(). */
+extern dt_strfdt_prog_t dt_compile_strfdt(const char *fmt);
+
+/**
+ * Like dt_strfdt() but with a format compiled by dt_compile_strfdt(). */
+extern size_t
+dt_strfdt_run(
+	char *restrict buf, size_t bsz, dt_strfdt_prog_t prog,
+	struct dt_dt_s);
+
+/**
+ * Free a program obtained by dt_compile_strfdt(). */
+extern void dt_free_strfdt(dt_strfdt_prog_t);
+
+/**
+ * Obtain an empty memo for dt_strfdt_memo_run(), or NULL.
+ * Memos are not to be shared among threads and must not outlive the
+ * programs they have been used with, free them with
+ * dt_free_strfdt_memo(). */
+extern dt_strfdt_memo_t dt_make_strfdt_memo(void);
+
+/**
+ * Like dt_strfdt_run() but remember in M what the leading date, hour
+ * and minute fields of the format made of THAT, so that for a later
+ * date/time on the same date, or in the same minute, only the fields
+ * past those are printed afresh.  BUF must have room for at least 128
+ * bytes for M to be consulted. */
+extern size_t
+dt_strfdt_memo_run(
+	char *restrict buf, size_t bsz, dt_strfdt_prog_t prog,
+	dt_strfdt_memo_t m, struct dt_dt_s that);
+
+/**
+ * Free a memo obtained by dt_make_strfdt_memo(). */
+extern void dt_free_strfdt_memo(dt_strfdt_memo_t);
+
+/**
+ * Like dt_strfdt() for the N date/times DTS, the results are written
+ * one after another into BUF, of size BSZ, each \nul-terminated.
+ * If LENS is non-NULL LENS[I] is set to the length of the I-th result.
+ * Return the number of date/times that fit into BUF. */
+extern size_t
+dt_strfdt_v(
+	char *restrict buf, size_t bsz, const char *fmt,
+	const struct dt_dt_s *dts, size_t n, size_t *lens);
+
 /**
  * Parse durations as in 1w5d, etc. */
 extern struct dt_dtdur_s
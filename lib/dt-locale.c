@@ -47,12 +47,14 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include "dt-locale.h"
 #include "date-core.h"
 #include "date-core-strpf.h"
+#include "strops.h"
 #include "nifty.h"
 
 #if defined LOCALE_FILE
@@ -227,6 +229,73 @@ xmemmem(const char *hay, const size_t hayz, const char *ndl, const size_t ndlz)
 }
 
 
+/* tries of the input names, built on first use, dropped with the names */
+static strtrie_t __tlong_wday;
+static strtrie_t __tabbr_wday;
+static strtrie_t __tlong_mon;
+static strtrie_t __tabbr_mon;
+
+static int32_t
+__strtoi_names(
+	const char *s, const char **ep,
+	strtrie_t *tp, const char *const *arr, size_t narr)
+{
+	strtrie_t t = __atomic_load_n(tp, __ATOMIC_ACQUIRE);
+
+	if (UNLIKELY(t == NULL) && (t = make_strtrie(arr, narr)) != NULL) {
+		strtrie_t nil = NULL;
+
+		if (!__atomic_compare_exchange_n(
+			    tp, &nil, t, false,
+			    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			/* another thread was quicker */
+			free_strtrie(t);
+			t = nil;
+		}
+	}
+	if (UNLIKELY(t == NULL)) {
+		return strtoarri(s, ep, arr, narr);
+	}
+	return strtotriei(s, ep, t);
+}
+
+static inline void
+__strtoi_drop(strtrie_t *tp)
+{
+	free_strtrie(*tp);
+	*tp = NULL;
+	return;
+}
+
+DEFUN int32_t
+dut_strtoi_long_wday(const char *s, const char **ep)
+{
+	return __strtoi_names(
+		s, ep, &__tlong_wday, dut_long_wday, dut_nlong_wday);
+}
+
+DEFUN int32_t
+dut_strtoi_abbr_wday(const char *s, const char **ep)
+{
+	return __strtoi_names(
+		s, ep, &__tabbr_wday, dut_abbr_wday, dut_nabbr_wday);
+}
+
+DEFUN int32_t
+dut_strtoi_long_mon(const char *s, const char **ep)
+{
+	return __strtoi_names(
+		s, ep, &__tlong_mon, dut_long_mon, dut_nlong_mon);
+}
+
+DEFUN int32_t
+dut_strtoi_abbr_mon(const char *s, const char **ep)
+{
+	return __strtoi_names(
+		s, ep, &__tabbr_mon, dut_abbr_mon, dut_nabbr_mon);
+}
+
+
 /* locale business */
 static inline void
 __strp_reset_long_wday(void)
@@ -234,6 +303,7 @@ __strp_reset_long_wday(void)
 	if (dut_long_wday != __long_wday) {
 		free(deconst(dut_long_wday));
 	}
+	__strtoi_drop(&__tlong_wday);
 	dut_long_wday = __long_wday;
 	dut_rlong_wday = __rlong_wday;
 	return;
@@ -245,6 +315,7 @@ __strp_reset_abbr_wday(void)
 	if (dut_abbr_wday != __abbr_wday) {
 		free(deconst(dut_abbr_wday));
 	}
+	__strtoi_drop(&__tabbr_wday);
 	dut_abbr_wday = __abbr_wday;
 	dut_rabbr_wday = __rabbr_wday;
 	return;
@@ -256,6 +327,7 @@ __strp_reset_long_mon(void)
 	if (dut_long_mon != __long_mon) {
 		free(deconst(dut_long_mon));
 	}
+	__strtoi_drop(&__tlong_mon);
 	dut_long_mon = __long_mon;
 	dut_rlong_mon = __rlong_mon;
 	return;
@@ -267,6 +339,7 @@ __strp_reset_abbr_mon(void)
 	if (dut_abbr_mon != __abbr_mon) {
 		free(deconst(dut_abbr_mon));
 	}
+	__strtoi_drop(&__tabbr_mon);
 	dut_abbr_mon = __abbr_mon;
 	dut_rabbr_mon = __rabbr_mon;
 	return;
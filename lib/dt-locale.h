@@ -88,6 +88,15 @@ extern struct strprng_s dut_rabbr_mon;
 extern const char *dut_abab_mon;
 extern const ssize_t dut_nabab_mon;
 
+/**
+ * Like strtoarri() on dut_long_wday, dut_abbr_wday, dut_long_mon and
+ * dut_abbr_mon respectively, but in one pass through a case-folded trie
+ * of the names, built on first use. */
+extern int32_t dut_strtoi_long_wday(const char *s, const char **ep);
+extern int32_t dut_strtoi_abbr_wday(const char *s, const char **ep);
+extern int32_t dut_strtoi_long_mon(const char *s, const char **ep);
+extern int32_t dut_strtoi_abbr_mon(const char *s, const char **ep);
+
 
 /* public API */
 /**
@@ -41,6 +41,7 @@
 #if defined HAVE_CONFIG_H
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 /* for strncasecmp() */
@@ -387,6 +388,120 @@ strtoarri(const char *buf, const char **ep, const char *const *arr, size_t narr)
 	return -1;
 }
 
+/* case-insensitive tries over string arrays, nodes are numbered
+ * in the order of insertion, 0 is the root and means none otherwise */
+struct strtrie_s {
+	size_t nnode;
+	struct {
+		/* byte leading here, case-folded */
+		char c;
+		/* smallest array index of the strings ending here, or 0 */
+		uint8_t idx;
+		/* first child and next sibling */
+		uint16_t chld;
+		uint16_t next;
+	} node[];
+};
+
+static inline char
+__fold(char c)
+{
+/* like tolower() in the C locale */
+	return (char)((unsigned char)(c - 'A') < 26U ? c | 0x20 : c);
+}
+
+DEFUN strtrie_t
+make_strtrie(const char *const *arr, size_t narr)
+{
+	struct strtrie_s *res;
+	size_t z = 1U;
+
+	if (UNLIKELY(narr > UINT8_MAX)) {
+		return NULL;
+	}
+	for (size_t i = 1U; i < narr; i++) {
+		z += strlen(arr[i]);
+	}
+	if (UNLIKELY(z > UINT16_MAX)) {
+		return NULL;
+	} else if (UNLIKELY((res = malloc(
+				     sizeof(*res) +
+				     z * sizeof(*res->node))) == NULL)) {
+		return NULL;
+	}
+	res->nnode = 1U;
+	res->node[0U].c = '\0';
+	res->node[0U].idx = 0U;
+	res->node[0U].chld = 0U;
+	res->node[0U].next = 0U;
+	for (size_t i = 1U; i < narr; i++) {
+		size_t k = 0U;
+
+		for (const char *p = arr[i]; *p; p++) {
+			const char c = __fold(*p);
+			uint16_t *kp;
+
+			for (kp = &res->node[k].chld;
+			     *kp && res->node[*kp].c != c;
+			     kp = &res->node[*kp].next);
+			if (!*kp) {
+				const size_t n = res->nnode++;
+
+				res->node[n].c = c;
+				res->node[n].idx = 0U;
+				res->node[n].chld = 0U;
+				res->node[n].next = 0U;
+				*kp = (uint16_t)n;
+			}
+			k = *kp;
+		}
+		if (!res->node[k].idx) {
+			/* the first string wins, like in strtoarri() */
+			res->node[k].idx = (uint8_t)i;
+		}
+	}
+	return res;
+}
+
+DEFUN void
+free_strtrie(strtrie_t t)
+{
+	if (t != NULL) {
+		free(t);
+	}
+	return;
+}
+
+DEFUN int32_t
+strtotriei(const char *buf, const char **ep, strtrie_t t)
+{
+/* like strtoarri() but in one pass over BUF */
+	const char *rp = buf;
+	int32_t res = -1;
+
+	for (size_t k = 0U;; buf++) {
+		const unsigned int idx = t->node[k].idx;
+		const char c = __fold(*buf);
+
+		if (idx && (res < 0 || idx < (unsigned int)res)) {
+			res = idx;
+			rp = buf;
+		}
+		if (!c) {
+			break;
+		}
+		for (k = t->node[k].chld; k && t->node[k].c != c;
+		     k = t->node[k].next);
+		if (!k) {
+			break;
+		}
+	}
+	if (ep != NULL) {
+		*ep = rp;
+	}
+	return res;
+}
+
 DEFUN size_t
 arritostr(
 	char *restrict buf, size_t bsz, size_t i,
@@ -412,9 +527,9 @@ arritostr(
 
 #define ALPHABET_SIZE	(256)
 
-/* not reentrant */
-static unsigned char table[ALPHABET_SIZE];
-static unsigned char cycle = 0;
+/* not reentrant, but every thread gets its own table */
+static __thread unsigned char table[ALPHABET_SIZE];
+static __thread unsigned char cycle = 0;
 
 static inline bool
 in_current_set(unsigned char c)
@@ -90,6 +90,23 @@ extern size_t __ordtostr(char *buf, size_t bsz);
 extern int32_t
 strtoarri(const char *s, const char **ep, const char *const *arr, size_t narr);
 
+/**
+ * Tries over string arrays for case-insensitive lookups in one pass. */
+typedef struct strtrie_s *strtrie_t;
+
+/**
+ * Compile the string array ARR of size NARR into a trie,
+ * the 0-th index is left out just like in strtoarri(). */
+extern strtrie_t make_strtrie(const char *const *arr, size_t narr);
+
+/**
+ * Free a trie as obtained by make_strtrie(). */
+extern void free_strtrie(strtrie_t);
+
+/**
+ * Like strtoarri() but look up S in trie T. */
+extern int32_t strtotriei(const char *s, const char **ep, strtrie_t t);
+
 /**
  * Take a string array ARR (of size NARR) and an index I into the array, print
  * the string ARR[I] into BUF and return the number of bytes copied. */
@@ -47,6 +47,8 @@
 #include "dt-io.h"
 #include "dt-core-tz-glue.h"
 #include "dt-locale.h"
+#include "dt-io-zone.h"
+#include "dt-io-par.h"
 #include "prchunk.h"
 
 const char *prog = "dadd";
@@ -74,9 +76,12 @@ dadd_add(struct dt_dt_s d, struct dt_dtdur_s dur[], size_t ndur)
 
 
 struct mass_add_clo_s {
-	void *pctx;
 	const struct grep_atom_soa_s *gra;
+	char *const *fmt;
+	size_t nfmt;
 	struct __strpdtdur_st_s st;
+	/* durations read off the current line */
+	struct __strpdtdur_st_s lst;
 	struct dt_dt_s rd;
 	zif_t fromz;
 	zif_t hackz;
@@ -88,7 +93,9 @@ struct mass_add_clo_s {
 };
 
 static int
-proc_line(const struct mass_add_clo_s *clo, char *line, size_t llen)
+proc_line(
+	const struct mass_add_clo_s *clo, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
 	struct dt_dt_s d;
 	char *sp = NULL;
@@ -114,22 +121,24 @@ proc_line(const struct mass_add_clo_s *clo, char *line, size_t llen)
 			}
 
 			if (clo->sed_mode_p) {
-				__io_write(line, sp - line, stdout);
-				dt_io_write(d, clo->ofmt, clo->z, '\0');
+				dt_io_ob_ref(where, line, sp - line);
+				dt_io_ob_write(
+					where, d, clo->ofmt, clo->z, '\0');
 				llen -= (ep - line);
 				line = ep;
 				nmatch++;
 			} else {
-				dt_io_write(d, clo->ofmt, clo->z, '\n');
+				dt_io_ob_write(
+					where, d, clo->ofmt, clo->z, '\n');
 				break;
 			}
 		} else if (clo->sed_mode_p) {
 			llen = !(clo->empty_mode_p && !nmatch) ? llen : 0U;
 			line[llen] = '\n';
-			__io_write(line, llen + 1, stdout);
+			dt_io_ob_ref(where, line, llen + 1);
 			break;
 		} else if (clo->empty_mode_p) {
-			__io_write("\n", 1U, stdout);
+			dt_io_ob_putc(where, '\n');
 			break;
 		} else {
 			/* obviously unmatched, warn about it in non -q mode */
@@ -144,80 +153,142 @@ proc_line(const struct mass_add_clo_s *clo, char *line, size_t llen)
 }
 
 static int
-mass_add_dur(const struct mass_add_clo_s *clo)
+proc_line_ep(
+	const struct mass_add_clo_s *clo, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
-/* read lines from stdin
- * interpret as dates
- * add to reference duration
- * output */
-	size_t lno = 0;
-	int rc = 0;
+/* the whole line has to be a date/time */
+	struct dt_dt_s d;
+	char *ep = NULL;
 
-	for (char *line; prchunk_haslinep(clo->pctx); lno++) {
-		size_t llen = prchunk_getline(clo->pctx, &line);
+	if (UNLIKELY(!llen)) {
+		goto empty;
+	}
+	/* try and parse the line */
+	d = dt_io_strpdt_ep(line, clo->fmt, clo->nfmt, &ep, clo->fromz);
+	if (UNLIKELY(dt_unk_p(d))) {
+		goto empty;
+	} else if (ep && (unsigned)*ep >= ' ') {
+		goto empty;
+	}
+	/* do the adding */
+	d = dadd_add(d, clo->st.durs, clo->st.ndurs);
+	if (UNLIKELY(dt_unk_p(d))) {
+		goto empty;
+	}
 
-		rc |= proc_line(clo, line, llen);
+	if (clo->hackz == NULL && clo->fromz != NULL) {
+		/* fixup zone */
+		d = dtz_forgetz(d, clo->fromz);
 	}
-	return rc;
+	dt_io_ob_write(where, d, clo->ofmt, clo->z, '\n');
+	return 0;
+empty:
+	dt_io_ob_putc(where, '\n');
+	return 0;
 }
 
 static int
-mass_add_d(const struct mass_add_clo_s *clo)
+proc_line_d(
+	struct mass_add_clo_s *clo, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
-/* read lines from stdin
- * interpret as durations
+/* interpret line as durations
  * add to reference date
  * output */
-	size_t lno = 0;
 	struct dt_dt_s d;
-	struct __strpdtdur_st_s st = {0};
+	int has_dur_p  = 1;
 	int rc = 0;
 
-	for (char *line; prchunk_haslinep(clo->pctx); lno++) {
-		size_t llen;
-		int has_dur_p  = 1;
+	/* check for durations on this line */
+	do {
+		if (dt_io_strpdtdur(&clo->lst, line) < 0) {
+			has_dur_p = 0;
+		}
+	} while (__strpdtdur_more_p(&clo->lst));
 
-		llen = prchunk_getline(clo->pctx, &line);
+	/* finish with newline again */
+	line[llen] = '\n';
 
-		/* check for durations on this line */
-		do {
-			if (dt_io_strpdtdur(&st, line) < 0) {
-				has_dur_p = 0;
-			}
-		} while (__strpdtdur_more_p(&st));
+	if (has_dur_p) {
+		if (UNLIKELY(clo->rd.fix) && !clo->quietp) {
+			rc = 2;
+		}
+		/* perform addition now */
+		d = dadd_add(clo->rd, clo->lst.durs, clo->lst.ndurs);
 
-		/* finish with newline again */
-		line[llen] = '\n';
+		if (clo->hackz == NULL && clo->fromz != NULL) {
+			/* fixup zone */
+			d = dtz_forgetz(d, clo->fromz);
+		}
 
-		if (has_dur_p) {
-			if (UNLIKELY(clo->rd.fix) && !clo->quietp) {
-				rc = 2;
-			}
-			/* perform addition now */
-			d = dadd_add(clo->rd, st.durs, st.ndurs);
+		/* no sed mode here */
+		dt_io_ob_write(where, d, clo->ofmt, clo->z, '\n');
+	} else if (clo->sed_mode_p) {
+		dt_io_ob_ref(where, line, llen + 1);
+	} else if (!clo->quietp) {
+		line[llen] = '\0';
+		dt_io_warn_strpdt(line);
+		rc = 2;
+	}
+	/* just reset the ndurs slot */
+	clo->lst.ndurs = 0;
+	return rc;
+}
 
-			if (clo->hackz == NULL && clo->fromz != NULL) {
-				/* fixup zone */
-				d = dtz_forgetz(d, clo->fromz);
-			}
+static int
+par_line(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line(clo, line, llen, where);
+}
 
-			/* no sed mode here */
-			dt_io_write(d, clo->ofmt, clo->z, '\n');
-		} else if (clo->sed_mode_p) {
-			__io_write(line, llen + 1, stdout);
-		} else if (!clo->quietp) {
-			line[llen] = '\0';
-			dt_io_warn_strpdt(line);
-			rc = 2;
-		}
-		/* just reset the ndurs slot */
-		st.ndurs = 0;
+static int
+par_line_ep(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line_ep(clo, line, llen, where);
+}
+
+static int
+par_line_d(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line_d(clo, line, llen, where);
+}
+
+static int
+mass_add(
+	struct mass_add_clo_s *clo, dt_io_par_f f,
+	char *const *fn, size_t nfn, const struct dt_io_par_s *par)
+{
+/* read lines from the files FN, or stdin, and run F over them */
+	struct mass_add_clo_s wrk[par->njobs];
+	void *wclo[par->njobs];
+	int rc;
+
+	if (par->njobs <= 1U) {
+		rc = dt_io_par_files(fn, nfn, f, (void*[]){clo}, par);
+		/* free associated duration resources */
+		__strpdtdur_free(&clo->lst);
+		return rc;
+	}
+	/* every worker gets their own zones and duration parser state */
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		wrk[i] = *clo;
+		wrk[i].lst = (struct __strpdtdur_st_s){0};
+		wrk[i].fromz = dt_io_zone_dup(clo->fromz);
+		wrk[i].hackz = clo->hackz ? wrk[i].fromz : NULL;
+		wrk[i].z = dt_io_zone_dup(clo->z);
+		wclo[i] = wrk + i;
+	}
+	rc = dt_io_par_files(fn, nfn, f, wclo, par);
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		__strpdtdur_free(&wrk[i].lst);
+		dt_io_zone_free(wrk[i].fromz);
+		dt_io_zone_free(wrk[i].z);
 	}
-	/* free associated duration resources */
-	__strpdtdur_free(&st);
 	return rc;
 }
 
+
 
 #include "dadd.yucc"
 
@@ -227,7 +298,7 @@ main(int argc, char *argv[])
 	yuck_t argi[1U];
 	struct dt_dt_s d;
 	struct __strpdtdur_st_s st = {0};
-	const char *ofmt;
+	char *ofmt;
 	char **fmt;
 	size_t nfmt;
 	int rc = 0;
@@ -255,6 +326,15 @@ main(int argc, char *argv[])
 			dt_io_unescape(fmt[i]);
 		}
 	}
+	/* tokenise input and output formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	dt_io_comp_ofmts(&ofmt, 1U);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 
 	if (argi->from_locale_arg) {
 		setilocale(argi->from_locale_arg);
@@ -337,57 +417,35 @@ Error: cannot interpret date/time string `%s'", inp);
 			rc = 1;
 		}
 
-	} else if (st.ndurs && !argi->sed_mode_flag && argi->empty_mode_flag) {
-		size_t lno = 0U;
-		void *pctx;
-
-		/* no threads reading this stream */
-		__io_setlocking_bycaller(stdout);
-
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("could not open stdin");
-			goto clear;
-		}
-
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-				char *ep = NULL;
-
-				if (UNLIKELY(!llen)) {
-					goto empty;
-				}
-				/* try and parse the line */
-				d = dt_io_strpdt_ep(line, fmt, nfmt, &ep, fromz);
-				if (UNLIKELY(dt_unk_p(d))) {
-					goto empty;
-				} else if (ep && (unsigned)*ep >= ' ') {
-					goto empty;
-				}
-				/* do the adding */
-				d = dadd_add(d, st.durs, st.ndurs);
-				if (UNLIKELY(dt_unk_p(d))) {
-					goto empty;
-				}
-
-				if (hackz == NULL && fromz != NULL) {
-					/* fixup zone */
-					d = dtz_forgetz(d, fromz);
-				}
-				dt_io_write(d, ofmt, z, '\n');
-				continue;
-			empty:
-				__io_write("\n", 1U, stdout);
-			}
-		}
-	} else if (st.ndurs) {
-		/* read dates from stdin */
+	} else {
+		/* read dates or durations from stdin or files */
 		struct grep_atom_s __nstk[16], *needle = __nstk;
 		size_t nneedle = countof(__nstk);
 		struct grep_atom_soa_s ndlsoa;
 		struct mass_add_clo_s clo[1];
-		void *pctx;
+		dt_io_par_f f;
+		struct dt_io_par_s par = {
+			.njobs = 1U,
+			.ordp = !argi->unordered_flag,
+		};
+
+		if (argi->jobs_arg) {
+			par.njobs = dt_io_par_njobs(
+				strtol(argi->jobs_arg, NULL, 10));
+		}
+		if (argi->field_arg &&
+		    dt_io_par_field(
+			    &par, argi->delimiter_arg, argi->field_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		if (argi->buffer_size_arg &&
+		    dt_io_par_obsz(&par, argi->buffer_size_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		par.linep |= argi->line_buffered_flag;
+		par.rahp = argi->read_ahead_flag;
 
 		/* no threads reading this stream */
 		__io_setlocking_bycaller(stdout);
@@ -401,62 +459,41 @@ Error: cannot interpret date/time string `%s'", inp);
 		/* and now build the needle */
 		ndlsoa = build_needle(needle, nneedle, fmt, nfmt);
 
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("could not open stdin");
-			goto ndl_free;
-		}
-
 		/* build the clo and then loop */
-		clo->pctx = pctx;
-		clo->gra = &ndlsoa;
-		clo->st = st;
-		clo->fromz = fromz;
-		clo->hackz = hackz;
-		clo->z = z;
-		clo->ofmt = ofmt;
-		clo->sed_mode_p = argi->sed_mode_flag;
-		clo->empty_mode_p = argi->empty_mode_flag;
-		clo->quietp = argi->quiet_flag;
-		while (prchunk_fill(pctx) >= 0) {
-			rc |= mass_add_dur(clo);
+		*clo = (struct mass_add_clo_s){
+			.gra = &ndlsoa,
+			.fmt = fmt,
+			.nfmt = nfmt,
+			.st = st,
+			.rd = d,
+			.fromz = fromz,
+			.hackz = hackz,
+			.z = z,
+			.ofmt = ofmt,
+			.sed_mode_p = argi->sed_mode_flag,
+			.empty_mode_p = argi->empty_mode_flag,
+			.quietp = argi->quiet_flag,
+		};
+		if (st.ndurs && !argi->sed_mode_flag && argi->empty_mode_flag) {
+			/* mass-adding durations to whole-line dates */
+			f = par_line_ep;
+		} else if (st.ndurs) {
+			/* mass-adding durations to dates on stdin */
+			f = par_line;
+		} else {
+			/* mass-adding durations on stdin to reference date */
+			f = par_line_d;
+		}
+		/* files or stdin, via the prchunk reader */
+		with (int res) {
+			res = mass_add(
+				clo, f,
+				argi->input_args, argi->input_nargs, &par);
+			rc = res < 0 ? 1 : rc | res;
 		}
-		/* get rid of resources */
-		free_prchunk(pctx);
-	ndl_free:
 		if (needle != __nstk) {
 			free(needle);
 		}
-
-	} else {
-		/* mass-adding durations to reference date */
-		struct mass_add_clo_s clo[1];
-		void *pctx;
-
-		/* no threads reading this stream */
-		__io_setlocking_bycaller(stdout);
-
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("could not open stdin");
-			goto clear;
-		}
-
-		/* build the clo and then loop */
-		clo->pctx = pctx;
-		clo->rd = d;
-		clo->fromz = fromz;
-		clo->hackz = hackz;
-		clo->z = z;
-		clo->ofmt = ofmt;
-		clo->sed_mode_p = argi->sed_mode_flag;
-		clo->empty_mode_p = argi->empty_mode_flag;
-		clo->quietp = argi->quiet_flag;
-		while (prchunk_fill(pctx) >= 0) {
-			rc |= mass_add_d(clo);
-		}
-		/* get rid of resources */
-		free_prchunk(pctx);
 	}
 clear:
 	/* free the strpdur status */
@@ -471,6 +508,9 @@ clear:
 	}
 
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
+	dt_io_free_ofmts();
 	yuck_free(argi);
 	return rc;
 }
@@ -46,6 +46,8 @@
 #include "dt-core.h"
 #include "dt-io.h"
 #include "dt-locale.h"
+#include "dt-io-zone.h"
+#include "dt-io-par.h"
 #include "prchunk.h"
 
 
@@ -53,7 +55,12 @@ const char *prog = "dconv";
 
 struct prln_ctx_s {
 	struct grep_atom_soa_s *ndl;
-	const char *ofmt;
+	char *const *fmt;
+	size_t nfmt;
+	char *const *ofmt;
+	size_t nofmt;
+	char sep;
+	const struct dt_io_bin_s *bin;
 	zif_t fromz;
 	zif_t outz;
 	int sed_mode_p;
@@ -61,8 +68,36 @@ struct prln_ctx_s {
 	int quietp;
 };
 
+static inline int
+write_fmts(
+	struct prln_ctx_s ctx, struct dt_io_ob_s *where,
+	struct dt_dt_s d, int apnd_ch)
+{
+	if (UNLIKELY(ctx.bin != NULL)) {
+		return dt_io_ob_write_bin(where, d, ctx.bin, ctx.outz);
+	} else if (LIKELY(ctx.nofmt == 1U)) {
+		return dt_io_ob_write(where, d, *ctx.ofmt, ctx.outz, apnd_ch);
+	}
+	return dt_io_ob_write_fmts(
+		where, d, ctx.ofmt, ctx.nofmt, ctx.outz, ctx.sep, apnd_ch);
+}
+
+static inline void
+write_empty(struct prln_ctx_s ctx, struct dt_io_ob_s *where)
+{
+	if (UNLIKELY(ctx.bin != NULL)) {
+		/* a null record keeps the records in line with the input */
+		dt_io_ob_write_bin(where, (struct dt_dt_s){DT_UNK}, ctx.bin, NULL);
+		return;
+	}
+	dt_io_ob_putc(where, '\n');
+	return;
+}
+
 static int
-proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
+proc_line(
+	struct prln_ctx_s ctx, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
 	struct dt_dt_s d;
 	char *sp = NULL;
@@ -76,8 +111,8 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 
 		/* check if line matches */
 		if (!dt_unk_p(d) && ctx.sed_mode_p) {
-			__io_write(line, sp - line, stdout);
-			dt_io_write(d, ctx.ofmt, ctx.outz, '\0');
+			dt_io_ob_ref(where, line, sp - line);
+			write_fmts(ctx, where, d, '\0');
 			llen -= (ep - line);
 			line = ep;
 			nmatch++;
@@ -85,15 +120,15 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 			if (UNLIKELY(d.fix) && !ctx.quietp) {
 				rc = 2;
 			}
-			dt_io_write(d, ctx.ofmt, ctx.outz, '\n');
+			write_fmts(ctx, where, d, '\n');
 			break;
 		} else if (ctx.sed_mode_p) {
 			llen = !(ctx.empty_mode_p && !nmatch) ? llen : 0U;
 			line[llen] = '\n';
-			__io_write(line, llen + 1, stdout);
+			dt_io_ob_ref(where, line, llen + 1);
 			break;
 		} else if (ctx.empty_mode_p) {
-			__io_write("\n", 1U, stdout);
+			write_empty(ctx, where);
 			break;
 		} else {
 			/* obviously unmatched, warn about it in non -q mode */
@@ -107,34 +142,128 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 	return rc;
 }
 
+static int
+proc_line_ep(
+	struct prln_ctx_s ctx, char *line, size_t llen,
+	struct dt_io_ob_s *where)
+{
+/* the whole line has to be a date/time */
+	struct dt_dt_s d;
+	char *ep = NULL;
+
+	if (UNLIKELY(!llen)) {
+		goto empty;
+	}
+	/* try and parse the line */
+	d = dt_io_strpdt_ep(line, ctx.fmt, ctx.nfmt, &ep, ctx.fromz);
+	if (UNLIKELY(dt_unk_p(d))) {
+		goto empty;
+	} else if (ep && (unsigned)*ep >= ' ') {
+		goto empty;
+	}
+	write_fmts(ctx, where, d, '\n');
+	return 0;
+empty:
+	write_empty(ctx, where);
+	return 0;
+}
+
+static int
+par_line(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line(*(struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+par_line_ep(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line_ep(*(struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+proc_files(
+	struct prln_ctx_s prln, char *const *fn, size_t nfn,
+	const struct dt_io_par_s *par)
+{
+/* run the line processors over the files FN, or stdin */
+	const dt_io_par_f f = !prln.sed_mode_p && prln.empty_mode_p
+		? par_line_ep : par_line;
+	struct prln_ctx_s wrk[par->njobs];
+	void *clo[par->njobs];
+	int rc;
+
+	if (par->njobs <= 1U) {
+		return dt_io_par_files(fn, nfn, f, (void*[]){&prln}, par);
+	}
+	/* every worker gets their own zones */
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		wrk[i] = prln;
+		wrk[i].fromz = dt_io_zone_dup(prln.fromz);
+		wrk[i].outz = dt_io_zone_dup(prln.outz);
+		clo[i] = wrk + i;
+	}
+	rc = dt_io_par_files(fn, nfn, f, clo, par);
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		dt_io_zone_free(wrk[i].fromz);
+		dt_io_zone_free(wrk[i].outz);
+	}
+	return rc;
+}
+
+
 
 #include "dconv.yucc"
 
 int
 main(int argc, char *argv[])
 {
+	/* the default output format, outlives the run unlike a literal */
+	static char *dflt_ofmt[] = {NULL};
 	yuck_t argi[1U];
-	const char *ofmt;
+	char **ofmt;
+	size_t nofmt;
 	char **fmt;
 	size_t nfmt;
 	int rc = 0;
 	zif_t fromz = NULL;
 	zif_t z = NULL;
+	struct dt_io_par_s par = {
+		.njobs = 1U,
+	};
+	struct dt_io_bin_s bin;
+	const struct dt_io_bin_s *binp = NULL;
 
 	if (yuck_parse(argi, argc, argv)) {
 		rc = 1;
 		goto out;
 	}
 	/* init and unescape sequences, maybe */
-	ofmt = argi->format_arg;
+	ofmt = argi->format_args;
+	nofmt = argi->format_nargs;
 	fmt = argi->input_format_args;
 	nfmt = argi->input_format_nargs;
+	if (!nofmt) {
+		/* just the default format then */
+		ofmt = dflt_ofmt;
+		nofmt = 1U;
+	}
 	if (argi->backslash_escapes_flag) {
-		dt_io_unescape(argi->format_arg);
+		for (size_t i = 0; i < nofmt && ofmt[i] != NULL; i++) {
+			dt_io_unescape(ofmt[i]);
+		}
 		for (size_t i = 0; i < nfmt; i++) {
 			dt_io_unescape(fmt[i]);
 		}
 	}
+	/* tokenise input and output formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	dt_io_comp_ofmts(ofmt, nofmt);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 
 	if (argi->locale_arg) {
 		setflocale(argi->locale_arg);
@@ -158,6 +287,30 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 		rc = 1;
 		goto clear;
 	}
+	if (argi->binary_arg) {
+		if (argi->sed_mode_flag || argi->field_arg) {
+			error("\
+Error: --binary cannot be used with --sed-mode or --field");
+			rc = 1;
+			goto clear;
+		} else if (dt_io_bin_cols(&bin, argi->binary_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		binp = &bin;
+		/* header first, the output buffers write to the fd directly */
+		with (char buf[8U + 16U * DT_IO_BIN_MAXCOL]) {
+			size_t n = dt_io_bin_hdr(buf, sizeof(buf), binp);
+			__io_write(buf, n, stdout);
+			fflush(stdout);
+		}
+	}
+	/* several output formats are separated like the fields of -k */
+	if (nofmt > 1U &&
+	    dt_io_par_field(&par, argi->delimiter_arg, NULL) < 0) {
+		rc = 1;
+		goto clear;
+	}
 	if (argi->base_arg) {
 		struct dt_dt_s base = dt_strpdt(argi->base_arg, NULL, NULL);
 		dt_set_base(base);
@@ -172,65 +325,57 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 				if (UNLIKELY(d.fix) && !argi->quiet_flag) {
 					rc = 2;
 				}
-				dt_io_write(d, ofmt, z, '\n');
+				if (UNLIKELY(binp != NULL)) {
+					dt_io_write_bin(d, binp, z);
+				} else if (LIKELY(nofmt == 1U)) {
+					dt_io_write(d, *ofmt, z, '\n');
+				} else {
+					dt_io_write_fmts(
+						d, ofmt, nofmt, z,
+						par.dlm, '\n');
+				}
 			} else if (!argi->quiet_flag) {
 				rc = 2;
 				dt_io_warn_strpdt(inp);
 			}
 		}
-	} else if (!argi->sed_mode_flag && argi->empty_mode_flag) {
-		/* read from stdin */
-		size_t lno = 0;
-		void *pctx;
-
-		/* no threads reading this stream */
-		__io_setlocking_bycaller(stdout);
-
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("Error: could not open stdin");
-			goto clear;
-		}
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-				struct dt_dt_s d;
-				char *ep = NULL;
-
-				if (UNLIKELY(!llen)) {
-					goto empty;
-				}
-				/* try and parse the line */
-				d = dt_io_strpdt_ep(line, fmt, nfmt, &ep, fromz);
-				if (UNLIKELY(dt_unk_p(d))) {
-					goto empty;
-				} else if (ep && (unsigned)*ep >= ' ') {
-					goto empty;
-				}
-				dt_io_write(d, ofmt, z, '\n');
-				continue;
-			empty:
-				__io_write("\n", 1U, stdout);
-			}
-		}
-		/* get rid of resources */
-		free_prchunk(pctx);
 	} else {
 		/* read from stdin */
-		size_t lno = 0;
 		struct grep_atom_s __nstk[16], *needle = __nstk;
 		size_t nneedle = countof(__nstk);
 		struct grep_atom_soa_s ndlsoa;
-		void *pctx;
 		struct prln_ctx_s prln = {
 			.ndl = &ndlsoa,
+			.fmt = fmt,
+			.nfmt = nfmt,
 			.ofmt = ofmt,
+			.nofmt = nofmt,
+			.sep = par.dlm,
+			.bin = binp,
 			.fromz = fromz,
 			.outz = z,
 			.sed_mode_p = argi->sed_mode_flag,
 			.empty_mode_p = argi->empty_mode_flag,
 			.quietp = argi->quiet_flag,
 		};
+		par.ordp = !argi->unordered_flag;
+		if (argi->jobs_arg) {
+			par.njobs = dt_io_par_njobs(
+				strtol(argi->jobs_arg, NULL, 10));
+		}
+		if (argi->field_arg &&
+		    dt_io_par_field(
+			    &par, argi->delimiter_arg, argi->field_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		if (argi->buffer_size_arg &&
+		    dt_io_par_obsz(&par, argi->buffer_size_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		par.linep |= argi->line_buffered_flag;
+		par.rahp = argi->read_ahead_flag;
 
 		/* no threads reading this stream */
 		__io_setlocking_bycaller(stdout);
@@ -244,21 +389,13 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 		/* and now build the needles */
 		ndlsoa = build_needle(needle, nneedle, fmt, nfmt);
 
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("Error: could not open stdin");
-			goto ndl_free;
-		}
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-
-				rc |= proc_line(prln, line, llen);
-			}
+		/* files or stdin, via the prchunk reader */
+		with (int res) {
+			res = proc_files(
+				prln,
+				argi->input_args, argi->input_nargs, &par);
+			rc = res < 0 ? 1 : rc | res;
 		}
-		/* get rid of resources */
-		free_prchunk(pctx);
-	ndl_free:
 		if (needle != __nstk) {
 			free(needle);
 		}
@@ -274,6 +411,9 @@ clear:
 	}
 
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
+	dt_io_free_ofmts();
 	yuck_free(argi);
 	return rc;
 }
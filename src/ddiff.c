@@ -47,6 +47,8 @@
 #include "dt-core-private.h"
 #include "dt-io.h"
 #include "dt-locale.h"
+#include "dt-io-zone.h"
+#include "dt-io-par.h"
 #include "prchunk.h"
 
 #if !defined UNUSED
@@ -627,23 +629,124 @@ out:
 	return bp - buf;
 }
 
-static int
-ddiff_prnt(struct dt_dtdur_s dur, const char *fmt, durfmt_t f, bool only_d_p)
+static size_t
+ddiff_strf(
+	char *restrict buf, size_t bsz,
+	struct dt_dtdur_s dur, const char *fmt, durfmt_t f, bool only_d_p)
 {
 /* this is mainly a better dt_strfdtdur() */
-	char buf[256];
-	size_t res = __strfdtdur(buf, sizeof(buf), fmt, dur, f, only_d_p);
+	size_t res = __strfdtdur(buf, bsz, fmt, dur, f, only_d_p);
 
 	if (res > 0 && buf[res - 1] != '\n') {
 		/* auto-newline */
 		buf[res++] = '\n';
 	}
+	return res;
+}
+
+static int
+ddiff_prnt(struct dt_dtdur_s dur, const char *fmt, durfmt_t f, bool only_d_p)
+{
+	char buf[256];
+	size_t res = ddiff_strf(buf, sizeof(buf), dur, fmt, f, only_d_p);
+
 	if (res > 0) {
 		__io_write(buf, res, stdout);
 	}
 	return (res > 0) - 1;
 }
 
+struct prln_ctx_s {
+	struct dt_dt_s d;
+	const char *refinp;
+	char *const *fmt;
+	size_t nfmt;
+	zif_t fromz;
+	const char *ofmt;
+	durfmt_t dfmt;
+	int empty_mode_p;
+	int quietp;
+};
+
+static int
+proc_line(
+	struct prln_ctx_s ctx, char *line, size_t UNUSED(llen),
+	struct dt_io_ob_s *where)
+{
+	struct dt_dt_s d2;
+	struct dt_dtdur_s dur;
+	dt_dtdurtyp_t dtyp;
+	bool onlydp;
+	int rc = 0;
+
+	d2 = dt_io_strpdt(line, ctx.fmt, ctx.nfmt, ctx.fromz);
+
+	if (dt_unk_p(d2)) {
+		if (!ctx.quietp) {
+			dt_io_warn_strpdt(line);
+			rc = 2;
+		}
+		if (ctx.empty_mode_p) {
+			/* empty line */
+			dt_io_ob_putc(where, '\n');
+		}
+		return rc;
+	} else if (UNLIKELY(d2.fix) && !ctx.quietp) {
+		rc = 2;
+	}
+	/* guess the diff type */
+	onlydp = dt_sandwich_only_d_p(ctx.d) || dt_sandwich_only_d_p(d2);
+	if (!(dtyp = determine_durtype(ctx.d, d2, ctx.dfmt))) {
+		if (!ctx.quietp) {
+			dt_io_warn_dur(ctx.refinp, line);
+			rc = 2;
+		}
+		return rc;
+	}
+	/* perform subtraction now */
+	dur = dt_dtdiff(dtyp, ctx.d, d2);
+	with (char buf[256]) {
+		size_t n = ddiff_strf(
+			buf, sizeof(buf), dur, ctx.ofmt, ctx.dfmt, onlydp);
+
+		dt_io_ob_put(where, buf, n);
+	}
+	return rc;
+}
+
+static int
+par_line(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line(*(const struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+proc_files(
+	struct prln_ctx_s prln, char *const *fn, size_t nfn,
+	const struct dt_io_par_s *par)
+{
+/* run the line processor over the files FN, or stdin */
+	struct prln_ctx_s wrk[par->njobs];
+	void *clo[par->njobs];
+	int rc;
+
+	if (par->njobs <= 1U) {
+		return dt_io_par_files(
+			fn, nfn, par_line, (void*[]){&prln}, par);
+	}
+	/* every worker gets their own zone */
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		wrk[i] = prln;
+		wrk[i].fromz = dt_io_zone_dup(prln.fromz);
+		clo[i] = wrk + i;
+	}
+	rc = dt_io_par_files(fn, nfn, par_line, clo, par);
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		dt_io_zone_free(wrk[i].fromz);
+	}
+	return rc;
+}
+
 
 #include "ddiff.yucc"
 
@@ -690,6 +793,14 @@ Error: cannot find zone specified in --from-zone: `%s'", argi->from_zone_arg);
 	ofmt = argi->format_arg;
 	fmt = argi->input_format_args;
 	nfmt = argi->input_format_nargs;
+	/* tokenise input formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 
 	if (argi->nargs == 0 ||
 	    (refinp = argi->args[0U],
@@ -736,61 +847,53 @@ Error: cannot find zone specified in --from-zone: `%s'", argi->from_zone_arg);
 			ddiff_prnt(dur, ofmt, dfmt, onlydp);
 		}
 	} else {
-		/* read from stdin */
-		size_t lno = 0;
-		void *pctx;
-
-		/* convert deprecated -S|--skip-illegal */
-		argi->empty_mode_flag += argi->skip_illegal_flag;
+		/* read from stdin or files */
+		struct prln_ctx_s prln = {
+			.d = d,
+			.refinp = refinp,
+			.fmt = fmt,
+			.nfmt = nfmt,
+			.fromz = fromz,
+			.ofmt = ofmt,
+			.dfmt = dfmt,
+			/* convert deprecated -S|--skip-illegal */
+			.empty_mode_p =
+			argi->empty_mode_flag + argi->skip_illegal_flag,
+			.quietp = argi->quiet_flag,
+		};
+		struct dt_io_par_s par = {
+			.njobs = 1U,
+			.ordp = !argi->unordered_flag,
+		};
+
+		if (argi->jobs_arg) {
+			par.njobs = dt_io_par_njobs(
+				strtol(argi->jobs_arg, NULL, 10));
+		}
+		if (argi->field_arg &&
+		    dt_io_par_field(
+			    &par, argi->delimiter_arg, argi->field_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		if (argi->buffer_size_arg &&
+		    dt_io_par_obsz(&par, argi->buffer_size_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		par.linep |= argi->line_buffered_flag;
+		par.rahp = argi->read_ahead_flag;
 
 		/* no threads reading this stream */
 		__io_setlocking_bycaller(stdout);
 
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("Error: could not open stdin");
-			goto out;
-		}
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				struct dt_dt_s d2;
-				struct dt_dtdur_s dur;
-				bool onlydp;
-
-				(void)prchunk_getline(pctx, &line);
-				d2 = dt_io_strpdt(line, fmt, nfmt, fromz);
-
-				if (dt_unk_p(d2)) {
-					if (!argi->quiet_flag) {
-						dt_io_warn_strpdt(line);
-						rc = 2;
-					}
-					if (argi->empty_mode_flag) {
-						/* empty line */
-						__io_write("\n", 1U, stdout);
-					}
-					continue;
-				} else if (UNLIKELY(d2.fix) &&
-					   !argi->quiet_flag) {
-					rc = 2;
-				}
-				/* guess the diff type */
-				onlydp = dt_sandwich_only_d_p(d) ||
-					dt_sandwich_only_d_p(d2);
-				if (!(dtyp = determine_durtype(d, d2, dfmt))) {
-					if (!argi->quiet_flag) {
-						dt_io_warn_dur(refinp, line);
-						rc = 2;
-					}
-					continue;
-				}
-				/* perform subtraction now */
-				dur = dt_dtdiff(dtyp, d, d2);
-				ddiff_prnt(dur, ofmt, dfmt, onlydp);
-			}
+		/* files or stdin, via the prchunk reader */
+		with (int res) {
+			res = proc_files(
+				prln,
+				argi->input_args, argi->input_nargs, &par);
+			rc = res < 0 ? 1 : rc | res;
 		}
-		/* get rid of resources */
-		free_prchunk(pctx);
 	}
 
 clear:
@@ -800,6 +903,8 @@ clear:
 	}
 
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
 	yuck_free(argi);
 	return rc;
 }
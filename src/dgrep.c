@@ -48,6 +48,8 @@
 #include "dt-io.h"
 #include "dexpr.h"
 #include "dt-locale.h"
+#include "dt-io-zone.h"
+#include "dt-io-par.h"
 #include "prchunk.h"
 
 const char *prog = "dgrep";
@@ -65,8 +67,10 @@ struct prln_ctx_s {
 	unsigned int invert_match_p:1U;
 };
 
-static void
-proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
+static int
+proc_line(
+	struct prln_ctx_s ctx, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
 	char *osp = NULL;
 	char *oep = NULL;
@@ -91,15 +95,15 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 		if (dexpr_matches_p(ctx.root, d)) {
 			if (ctx.invert_match_p) {
 				/* nothing must match */
-				return;
+				return 0;
 			} else if (!ctx.only_matching_p) {
 				sp = line;
 				ep = line + llen;
 			}
 			/* make sure we finish the line */
 			*ep++ = '\n';
-			__io_write(sp, ep - sp, stdout);
-			return;
+			dt_io_ob_ref(where, sp, ep - sp);
+			return 0;
 		}
 	}
 	if (ctx.invert_match_p) {
@@ -110,15 +114,51 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 		} else if (osp == NULL || oep == NULL) {
 			/* no date in line and only-matching is active
 			 * bugger off */
-			return;
+			return 0;
 		}
 		/* finish the line and bugger off */
 		*oep++ = '\n';
-		__io_write(osp, oep - osp, stdout);
+		dt_io_ob_ref(where, osp, oep - osp);
 	}
-	return;
+	return 0;
 }
 
+static int
+par_line(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line(*(const struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+proc_files(
+	struct prln_ctx_s prln, char *const *fn, size_t nfn,
+	const struct dt_io_par_s *par)
+{
+/* run the line processor over the files FN, or stdin */
+	struct prln_ctx_s wrk[par->njobs];
+	void *clo[par->njobs];
+	int rc;
+
+	if (par->njobs <= 1U) {
+		return dt_io_par_files(
+			fn, nfn, par_line, (void*[]){&prln}, par);
+	}
+	/* every worker gets their own zones */
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		wrk[i] = prln;
+		wrk[i].fromz = dt_io_zone_dup(prln.fromz);
+		wrk[i].z = dt_io_zone_dup(prln.z);
+		clo[i] = wrk + i;
+	}
+	rc = dt_io_par_files(fn, nfn, par_line, clo, par);
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		dt_io_zone_free(wrk[i].fromz);
+		dt_io_zone_free(wrk[i].z);
+	}
+	return rc;
+}
+
+
 
 #include "dgrep.yucc"
 
@@ -147,6 +187,14 @@ main(int argc, char *argv[])
 			dt_io_unescape(fmt[i]);
 		}
 	}
+	/* tokenise input formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 	if (argi->base_arg) {
 		struct dt_dt_s base = dt_strpdt(argi->base_arg, NULL, NULL);
 		dt_set_base(base);
@@ -206,12 +254,10 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 	dexpr_simplify(root);
 	/* beef */
 	{
-		/* read from stdin */
-		size_t lno = 0;
+		/* read from stdin or files */
 		struct grep_atom_s __nstk[16], *needle = __nstk;
 		size_t nneedle = countof(__nstk);
 		struct grep_atom_soa_s ndlsoa;
-		void *pctx;
 		struct prln_ctx_s prln = {
 			.ndl = &ndlsoa,
 			.root = root,
@@ -220,6 +266,28 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 			.only_matching_p = argi->only_matching_flag,
 			.invert_match_p = argi->invert_match_flag,
 		};
+		struct dt_io_par_s par = {
+			.njobs = 1U,
+			.ordp = !argi->unordered_flag,
+		};
+
+		if (argi->jobs_arg) {
+			par.njobs = dt_io_par_njobs(
+				strtol(argi->jobs_arg, NULL, 10));
+		}
+		if (argi->field_arg &&
+		    dt_io_par_field(
+			    &par, argi->delimiter_arg, argi->field_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		if (argi->buffer_size_arg &&
+		    dt_io_par_obsz(&par, argi->buffer_size_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		par.linep |= argi->line_buffered_flag;
+		par.rahp = argi->read_ahead_flag;
 
 		/* no threads reading this stream */
 		__io_setlocking_bycaller(stdout);
@@ -233,21 +301,12 @@ Error: cannot find zone specified in --zone: `%s'", argi->zone_arg);
 		/* and now build the needle */
 		ndlsoa = build_needle(needle, nneedle, fmt, nfmt);
 
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("Error: could not open stdin");
-			goto ndl_free;
-		}
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-
-				proc_line(prln, line, llen);
-			}
+		/* files or stdin, via the prchunk reader */
+		if (proc_files(
+			    prln,
+			    argi->input_args, argi->input_nargs, &par) < 0) {
+			rc = 1;
 		}
-		/* get rid of resources */
-		free_prchunk(pctx);
-	ndl_free:
 		if (needle != __nstk) {
 			free(needle);
 		}
@@ -260,6 +319,8 @@ clear:
 		setilocale(NULL);
 	}
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
 	yuck_free(argi);
 	return rc;
 }
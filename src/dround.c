@@ -47,6 +47,8 @@
 #include "dt-io.h"
 #include "dt-core-tz-glue.h"
 #include "dt-locale.h"
+#include "dt-io-zone.h"
+#include "dt-io-par.h"
 #include "prchunk.h"
 /* parsers and formatters */
 #include "date-core-strpf.h"
@@ -749,6 +751,8 @@ out:
 
 struct prln_ctx_s {
 	struct grep_atom_soa_s *ndl;
+	char *const *fmt;
+	size_t nfmt;
 	const char *ofmt;
 	zif_t fromz;
 	zif_t outz;
@@ -761,7 +765,9 @@ struct prln_ctx_s {
 };
 
 static int
-proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
+proc_line(
+	struct prln_ctx_s ctx, char *line, size_t llen,
+	struct dt_io_ob_s *where)
 {
 	struct dt_dt_s d;
 	char *sp = NULL;
@@ -787,22 +793,24 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 			}
 
 			if (ctx.sed_mode_p) {
-				__io_write(line, sp - line, stdout);
-				dt_io_write(d, ctx.ofmt, ctx.outz, '\0');
+				dt_io_ob_ref(where, line, sp - line);
+				dt_io_ob_write(
+					where, d, ctx.ofmt, ctx.outz, '\0');
 				llen -= (ep - line);
 				line = ep;
 				nmatch++;
 			} else {
-				dt_io_write(d, ctx.ofmt, ctx.outz, '\n');
+				dt_io_ob_write(
+					where, d, ctx.ofmt, ctx.outz, '\n');
 				break;
 			}
 		} else if (ctx.sed_mode_p) {
 			llen = !(ctx.empty_mode_p && !nmatch) ? llen : 0U;
 			line[llen] = '\n';
-			__io_write(line, llen + 1, stdout);
+			dt_io_ob_ref(where, line, llen + 1);
 			break;
 		} else if (ctx.empty_mode_p) {
-			__io_write("\n", 1U, stdout);
+			dt_io_ob_putc(where, '\n');
 			break;
 		} else {
 			/* obviously unmatched, warn about it in non -q mode */
@@ -816,6 +824,84 @@ proc_line(struct prln_ctx_s ctx, char *line, size_t llen)
 	return rc;
 }
 
+static int
+proc_line_ep(
+	struct prln_ctx_s ctx, char *line, size_t llen,
+	struct dt_io_ob_s *where)
+{
+/* exact/empty mode, the whole line has to be a date/time */
+	struct dt_dt_s d;
+	char *ep = NULL;
+
+	if (UNLIKELY(!llen)) {
+		goto empty;
+	}
+	/* try and parse the line */
+	d = dt_io_strpdt_ep(line, ctx.fmt, ctx.nfmt, &ep, ctx.fromz);
+	if (UNLIKELY(dt_unk_p(d))) {
+		goto empty;
+	} else if (ep && (unsigned)*ep >= ' ') {
+		goto empty;
+	}
+	/* do the rounding */
+	d = dround(d, ctx.st->durs, ctx.st->ndurs, ctx.nextp);
+	if (UNLIKELY(dt_unk_p(d))) {
+		goto empty;
+	}
+	if (ctx.fromz != NULL) {
+		/* fixup zone */
+		d = dtz_forgetz(d, ctx.fromz);
+	}
+	dt_io_ob_write(where, d, ctx.ofmt, ctx.outz, '\n');
+	return 0;
+empty:
+	dt_io_ob_putc(where, '\n');
+	return 0;
+}
+
+static int
+par_line(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line(*(const struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+par_line_ep(void *clo, char *line, size_t llen, struct dt_io_ob_s *where)
+{
+	return proc_line_ep(*(const struct prln_ctx_s*)clo, line, llen, where);
+}
+
+static int
+proc_files(
+	struct prln_ctx_s prln, char *const *fn, size_t nfn,
+	const struct dt_io_par_s *par)
+{
+/* run the line processors over the files FN, or stdin */
+	const dt_io_par_f f = !prln.sed_mode_p && prln.empty_mode_p
+		? par_line_ep : par_line;
+	struct prln_ctx_s wrk[par->njobs];
+	void *clo[par->njobs];
+	int rc;
+
+	if (par->njobs <= 1U) {
+		return dt_io_par_files(fn, nfn, f, (void*[]){&prln}, par);
+	}
+	/* every worker gets their own zones */
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		wrk[i] = prln;
+		wrk[i].fromz = dt_io_zone_dup(prln.fromz);
+		wrk[i].outz = dt_io_zone_dup(prln.outz);
+		clo[i] = wrk + i;
+	}
+	rc = dt_io_par_files(fn, nfn, f, clo, par);
+	for (unsigned int i = 0U; i < par->njobs; i++) {
+		dt_io_zone_free(wrk[i].fromz);
+		dt_io_zone_free(wrk[i].outz);
+	}
+	return rc;
+}
+
+
 
 #include "dround.yucc"
 
@@ -826,7 +912,7 @@ main(int argc, char *argv[])
 	struct dt_dt_s d;
 	struct __strpdtdur_st_s st = {0};
 	char *inp;
-	const char *ofmt;
+	char *ofmt;
 	char **fmt;
 	size_t nfmt;
 	int rc = 0;
@@ -854,6 +940,15 @@ main(int argc, char *argv[])
 			dt_io_unescape(fmt[i]);
 		}
 	}
+	/* tokenise input and output formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	dt_io_comp_ofmts(&ofmt, 1U);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 
 	if (argi->from_locale_arg) {
 		setilocale(argi->from_locale_arg);
@@ -1046,60 +1141,15 @@ no durations given");
 		} else {
 			rc = 1;
 		}
-	} else if (!argi->sed_mode_flag && argi->empty_mode_flag) {
-		/* read from stdin in exact/empty mode */
-		size_t lno = 0;
-		void *pctx;
-
-		/* no threads reading this stream */
-		__io_setlocking_bycaller(stdout);
-
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("could not open stdin");
-			goto clear;
-		}
-
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-				char *ep = NULL;
-
-
-				if (UNLIKELY(!llen)) {
-					goto empty;
-				}
-				/* try and parse the line */
-				d = dt_io_strpdt_ep(line, fmt, nfmt, &ep, fromz);
-				if (UNLIKELY(dt_unk_p(d))) {
-					goto empty;
-				} else if (ep && (unsigned)*ep >= ' ') {
-					goto empty;
-				}
-				/* do the rounding */
-				d = dround(d, st.durs, st.ndurs, nextp);
-				if (UNLIKELY(dt_unk_p(d))) {
-					goto empty;
-				}
-				if (fromz != NULL) {
-					/* fixup zone */
-					d = dtz_forgetz(d, fromz);
-				}
-				dt_io_write(d, ofmt, z, '\n');
-				continue;
-			empty:
-				__io_write("\n", 1U, stdout);
-			}
-		}
 	} else {
 		/* read from stdin */
-		size_t lno = 0;
 		struct grep_atom_s __nstk[16], *needle = __nstk;
 		size_t nneedle = countof(__nstk);
 		struct grep_atom_soa_s ndlsoa;
-		void *pctx;
 		struct prln_ctx_s prln = {
 			.ndl = &ndlsoa,
+			.fmt = fmt,
+			.nfmt = nfmt,
 			.ofmt = ofmt,
 			.fromz = fromz,
 			.outz = z,
@@ -1109,6 +1159,28 @@ no durations given");
 			.st = &st,
 			.nextp = nextp,
 		};
+		struct dt_io_par_s par = {
+			.njobs = 1U,
+			.ordp = !argi->unordered_flag,
+		};
+
+		if (argi->jobs_arg) {
+			par.njobs = dt_io_par_njobs(
+				strtol(argi->jobs_arg, NULL, 10));
+		}
+		if (argi->field_arg &&
+		    dt_io_par_field(
+			    &par, argi->delimiter_arg, argi->field_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		if (argi->buffer_size_arg &&
+		    dt_io_par_obsz(&par, argi->buffer_size_arg) < 0) {
+			rc = 1;
+			goto clear;
+		}
+		par.linep |= argi->line_buffered_flag;
+		par.rahp = argi->read_ahead_flag;
 
 		/* no threads reading this stream */
 		__io_setlocking_bycaller(stdout);
@@ -1123,21 +1195,13 @@ no durations given");
 		ndlsoa = build_needle(needle, nneedle, fmt, nfmt);
 
 
-		/* using the prchunk reader now */
-		if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
-			serror("Error: could not open stdin");
-			goto ndl_free;
-		}
-		while (prchunk_fill(pctx) >= 0) {
-			for (char *line; prchunk_haslinep(pctx); lno++) {
-				size_t llen = prchunk_getline(pctx, &line);
-
-				rc |= proc_line(prln, line, llen);
-			}
+		/* files or stdin, via the prchunk reader */
+		with (int res) {
+			res = proc_files(
+				prln,
+				argi->input_args, argi->input_nargs, &par);
+			rc = res < 0 ? 1 : rc | res;
 		}
-		/* get rid of resources */
-		free_prchunk(pctx);
-	ndl_free:
 		if (needle != __nstk) {
 			free(needle);
 		}
@@ -1156,6 +1220,9 @@ clear:
 	}
 
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
+	dt_io_free_ofmts();
 	yuck_free(argi);
 	return rc;
 }
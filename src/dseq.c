@@ -458,6 +458,7 @@ main(int argc, char *argv[])
 	size_t nifmt;
 	char *ofmt;
 	dt_dttyp_t tgttyp;
+	struct dt_io_bin_s bin;
 	int rc = 0;
 	struct dseq_clo_s clo = {
 		.ite = &ite_p1,
@@ -478,6 +479,15 @@ main(int argc, char *argv[])
 	if (argi->backslash_escapes_flag) {
 		dt_io_unescape(ofmt);
 	}
+	/* tokenise the output format once and for all */
+	dt_io_comp_ofmts(&ofmt, 1U);
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
+	if (argi->binary_arg && dt_io_bin_cols(&bin, argi->binary_arg) < 0) {
+		rc = 1;
+		goto out;
+	}
 	nifmt = argi->input_format_nargs;
 	ifmt = argi->input_format_args;
 
@@ -701,6 +711,18 @@ increment must not be naught");
 		tmp = __seq_this(clo.fst, &clo);
 	}
 
+	if (argi->binary_arg) {
+		char buf[8U + 16U * DT_IO_BIN_MAXCOL];
+		size_t n = dt_io_bin_hdr(buf, sizeof(buf), &bin);
+
+		__io_write(buf, n, stdout);
+		for (; __in_range_p(dt_fixup(tmp), &clo);
+		     tmp = __seq_next(tmp, &clo)) {
+			/* no need to convert, the stamp is all we want */
+			dt_io_write_bin(tmp, &bin, NULL);
+		}
+		goto out;
+	}
 	for (; __in_range_p(dt_fixup(tmp), &clo); tmp = __seq_next(tmp, &clo)) {
 		struct dt_dt_s tgt = tmp;
 
@@ -711,6 +733,7 @@ increment must not be naught");
 	}
 
 out:
+	dt_io_free_ofmts();
 	/* free strpdur resources */
 	if (clo.ite && clo.flags & CLO_FL_FREE_ITE) {
 		free(clo.ite);
@@ -44,6 +44,7 @@
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <time.h>
 
 #include "dt-core.h"
@@ -121,6 +122,7 @@ proc_file(struct prln_ctx_s prln, const char *fn)
 	size_t lno = 0;
 	void *pctx;
 	int fd;
+	int e;
 
 	if (fn == NULL) {
 		/* stdin then innit */
@@ -143,10 +145,17 @@ proc_file(struct prln_ctx_s prln, const char *fn)
 			proc_line(prln, line, llen);
 		}
 	}
+	if ((e = prchunk_error(pctx)) < 0) {
+		error("Error: corrupt or truncated compressed input in `%s'",
+		      fn ?: "<stdin>");
+	} else if (e > 0) {
+		errno = e;
+		serror("Error: cannot read from `%s'", fn ?: "<stdin>");
+	}
 	/* get rid of resources */
 	free_prchunk(pctx);
 	close(fd);
-	return 0;
+	return e ? -1 : 0;
 }
 
 
@@ -263,6 +272,14 @@ main(int argc, char *argv[])
 			dt_io_unescape(fmt[i]);
 		}
 	}
+	/* tokenise input formats once and for all */
+	dt_io_comp_fmts(fmt, nfmt);
+	if (argi->stats_flag) {
+		dt_io_count_fmts();
+	}
+	if (argi->memo_flag) {
+		dt_io_memo_fmts();
+	}
 
 	if (argi->from_locale_arg) {
 		setilocale(argi->from_locale_arg);
@@ -356,6 +373,8 @@ clear:
 	}
 
 out:
+	dt_io_fmts_stats();
+	dt_io_free_fmts();
 	yuck_free(argi);
 	return rc;
 }
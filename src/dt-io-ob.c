@@ -0,0 +1,338 @@
+/*** dt-io-ob.c -- explicitly managed output buffers
+ *
+ * Copyright (C) 2024 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of dateutils.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include "dt-core.h"
+#include "dt-core-tz-glue.h"
+#include "dt-io.h"
+#include "dt-io-ob.h"
+#include "nifty.h"
+
+#if !defined IOV_MAX
+# define IOV_MAX	(1024)
+#endif	/* !IOV_MAX */
+
+/* what a single formatted date/time may take up */
+#define MAX_STRFDT	(256U)
+/* number of spans a zero-copy buffer holds before it's flushed */
+#define NREF		(1024U)
+
+
+int
+dt_io_ob_init(struct dt_io_ob_s *ob, int fd, size_t bsz)
+{
+	*ob = (struct dt_io_ob_s){.fd = fd, .bsz = bsz ?: DT_IO_OB_BSZ};
+	if (UNLIKELY(ob->bsz < MAX_STRFDT)) {
+		ob->bsz = MAX_STRFDT;
+	}
+	if (UNLIKELY((ob->buf = malloc(ob->bsz)) == NULL)) {
+		ob->bsz = 0U;
+		return -1;
+	}
+	return 0;
+}
+
+int
+dt_io_ob_fini(struct dt_io_ob_s *ob)
+{
+	if (ob->fd >= 0) {
+		dt_io_ob_flush(ob);
+	}
+	if (ob->buf != NULL) {
+		free(ob->buf);
+	}
+	if (ob->ref != NULL) {
+		free(ob->ref);
+	}
+	ob->buf = NULL;
+	ob->bsz = 0U;
+	ob->ref = NULL;
+	ob->zref = 0U;
+	return ob->errp ? -1 : 0;
+}
+
+static int
+xwritev(int fd, struct iovec *iov, int niov)
+{
+/* writev() until everything's out */
+	while (niov > 0) {
+		ssize_t nwr = writev(fd, iov, niov < IOV_MAX ? niov : IOV_MAX);
+
+		if (UNLIKELY(nwr < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		/* skip what's been written */
+		for (; niov > 0 && (size_t)nwr >= iov->iov_len; iov++, niov--) {
+			nwr -= iov->iov_len;
+		}
+		if (niov > 0) {
+			iov->iov_base = (char*)iov->iov_base + nwr;
+			iov->iov_len -= nwr;
+		}
+	}
+	return 0;
+}
+
+static size_t
+ob_iov(struct iovec *restrict iov, struct dt_io_ob_s *ob)
+{
+/* put OB's contents into IOV, in order, and empty OB */
+	char *bp = ob->buf;
+	size_t niov = 0U;
+
+	for (size_t i = 0U; i < ob->nref; i++) {
+		char *p = ob->ref[i].p ?: bp;
+
+		iov[niov++] = (struct iovec){p, ob->ref[i].n};
+		bp += ob->ref[i].p ? 0U : ob->ref[i].n;
+	}
+	if (ob->len > ob->rof) {
+		iov[niov++] = (struct iovec){bp, ob->len - ob->rof};
+	}
+	ob->len = 0U;
+	ob->nref = 0U;
+	ob->rof = 0U;
+	ob->ip = NULL;
+	return niov;
+}
+
+int
+dt_io_ob_flush(struct dt_io_ob_s *ob)
+{
+	if (UNLIKELY(ob->fd < 0)) {
+		return 0;
+	} else if (ob->len == 0U && ob->nref == 0U) {
+		return 0;
+	}
+	with (struct iovec iov[ob->nref + 1U]) {
+		const size_t niov = ob_iov(iov, ob);
+
+		if (UNLIKELY(xwritev(ob->fd, iov, niov) < 0)) {
+			ob->errp = true;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int
+dt_io_ob_writev(int fd, struct dt_io_ob_s *ob, size_t nob)
+{
+	struct iovec *iov;
+	size_t niov = 0U;
+	int rc;
+
+	for (size_t i = 0U; i < nob; i++) {
+		niov += ob[i].nref + 1U;
+	}
+	if (UNLIKELY((iov = malloc(niov * sizeof(*iov))) == NULL)) {
+		rc = -1;
+		goto err;
+	}
+	niov = 0U;
+	for (size_t i = 0U; i < nob; i++) {
+		niov += ob_iov(iov + niov, ob + i);
+	}
+	rc = xwritev(fd, iov, niov);
+	free(iov);
+	if (UNLIKELY(rc < 0)) {
+	err:
+		for (size_t i = 0U; i < nob; i++) {
+			ob[i].errp = true;
+		}
+	}
+	return rc;
+}
+
+int
+__dt_io_ob_room(struct dt_io_ob_s *ob, size_t n)
+{
+	size_t nu;
+	char *tmp;
+
+	if (ob->fd >= 0 && ob->len && dt_io_ob_flush(ob) < 0) {
+		return -1;
+	} else if (ob->len + n <= ob->bsz) {
+		return 0;
+	}
+	/* grow then */
+	for (nu = ob->bsz ?: MAX_STRFDT; nu < ob->len + n; nu *= 2U);
+	if (UNLIKELY((tmp = realloc(ob->buf, nu)) == NULL)) {
+		ob->errp = true;
+		return -1;
+	}
+	ob->buf = tmp;
+	ob->bsz = nu;
+	return 0;
+}
+
+int
+__dt_io_ob_ref(struct dt_io_ob_s *ob, char *s, size_t n)
+{
+	if (s != ob->ip || ob->len != ob->iof) {
+		/* new span */
+		;
+	} else if (!ob->icp) {
+		/* S continues the last span */
+		ob->ref[ob->nref - 1U].n += n;
+		ob->ip += n;
+		return 0;
+	} else if (ob->icp + n < DT_IO_OB_MINREF) {
+		/* keep copying */
+		dt_io_ob_put(ob, s, n);
+		ob->icp = ob->ip != NULL ? ob->icp + n : n;
+		ob->ip = s + n;
+		ob->iof = ob->len;
+		return 0;
+	} else {
+		/* take back the copy and refer to the lot */
+		ob->len -= ob->icp;
+		s -= ob->icp;
+		n += ob->icp;
+	}
+
+	/* we need room for the buffer's pending span and S */
+	if (ob->nref + 2U > ob->zref) {
+		size_t nu = ob->zref ? ob->zref * 2U : NREF;
+		struct dt_io_ob_ref_s *tmp;
+
+		if (ob->zref && ob->fd >= 0) {
+			/* flush instead of growing */
+			if (dt_io_ob_flush(ob) < 0) {
+				return -1;
+			}
+		} else if ((tmp = realloc(ob->ref, nu * sizeof(*tmp))) != NULL) {
+			ob->ref = tmp;
+			ob->zref = nu;
+		} else {
+			/* copy it then */
+			dt_io_ob_put(ob, s, n);
+			ob->ip = NULL;
+			return 0;
+		}
+	}
+	if (ob->len > ob->rof) {
+		const size_t m = ob->len - ob->rof;
+
+		ob->ref[ob->nref++] = (struct dt_io_ob_ref_s){NULL, m};
+		ob->rof = ob->len;
+	}
+	ob->ref[ob->nref++] = (struct dt_io_ob_ref_s){s, n};
+	ob->ip = s + n;
+	ob->icp = 0U;
+	ob->iof = ob->len;
+	return 0;
+}
+
+int
+dt_io_ob_write(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, const char *fmt, zif_t zone, int apnd_ch)
+{
+	size_t n;
+
+	if (zone != NULL) {
+		d = dtz_enrichz(d, zone);
+	} else {
+		/* zone == NULL is UTC, kill zdiff */
+		d.zdiff = 0U;
+		d.neg = 0U;
+	}
+	if (UNLIKELY(ob->len + MAX_STRFDT > ob->bsz) &&
+	    __dt_io_ob_room(ob, MAX_STRFDT) < 0) {
+		return -1;
+	}
+	n = dt_io_strfdt(ob->buf + ob->len, MAX_STRFDT, fmt, d, apnd_ch);
+	ob->len += n;
+	return (n > 0) - 1;
+}
+
+int
+dt_io_ob_write_fmts(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, char *const *fmt, size_t nfmt, zif_t zone,
+	char sep, int apnd_ch)
+{
+	if (zone != NULL) {
+		d = dtz_enrichz(d, zone);
+	} else {
+		/* zone == NULL is UTC, kill zdiff */
+		d.zdiff = 0U;
+		d.neg = 0U;
+	}
+	for (size_t i = 0U; i < nfmt; i++) {
+		const int ch = i + 1U < nfmt ? '\0' : apnd_ch;
+		size_t n;
+
+		if (UNLIKELY(ob->len + MAX_STRFDT > ob->bsz) &&
+		    __dt_io_ob_room(ob, MAX_STRFDT) < 0) {
+			return -1;
+		}
+		n = dt_io_strfdt(ob->buf + ob->len, MAX_STRFDT - 1U, fmt[i], d, ch);
+		if (i + 1U < nfmt) {
+			/* separators go in unconditionally, to keep the columns */
+			ob->buf[ob->len + n++] = sep;
+		}
+		ob->len += n;
+	}
+	return 0;
+}
+
+int
+dt_io_ob_write_bin(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, const struct dt_io_bin_s *bin, zif_t zone)
+{
+	if (UNLIKELY(ob->len + bin->rsz > ob->bsz) &&
+	    __dt_io_ob_room(ob, bin->rsz) < 0) {
+		return -1;
+	}
+	ob->len += dt_io_bin_rec(ob->buf + ob->len, bin, d, zone);
+	return 0;
+}
+
+/* dt-io-ob.c ends here */
@@ -0,0 +1,207 @@
+/*** dt-io-ob.h -- explicitly managed output buffers
+ *
+ * Copyright (C) 2024 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of dateutils.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_dt_io_ob_h_
+#define INCLUDED_dt_io_ob_h_
+
+#include <stdbool.h>
+#include <string.h>
+#include "dt-core.h"
+#include "tzraw.h"
+#include "nifty.h"
+
+/* from dt-io.h */
+struct dt_io_bin_s;
+
+/* default size of output buffers that go to a file descriptor */
+#define DT_IO_OB_BSZ	(256U * 1024U)
+/* spans shorter than this are copied rather than referenced */
+#define DT_IO_OB_MINREF	(128U)
+
+/* a span of output, P == NULL denotes the next N bytes of the buffer */
+struct dt_io_ob_ref_s {
+	char *p;
+	size_t n;
+};
+
+/**
+ * Output buffer, results are appended to BUF and written to FD in
+ * large batches.  Buffers with a negative FD grow instead and their
+ * contents are for the owner to pass on.
+ * Zero-copy buffers additionally keep a list of spans so that
+ * unmodified input can be handed to writev(2) without copying.
+ * Every buffer belongs to exactly one thread. */
+struct dt_io_ob_s {
+	char *buf;
+	size_t len;
+	size_t bsz;
+	int fd;
+	/* flush at the end of every line, see dt_io_ob_eol() */
+	bool linep;
+	/* sticky, set when a write failed */
+	bool errp;
+	/* allow dt_io_ob_ref() to refer to memory instead of copying it */
+	bool zcp;
+	/* if so, the spans in order, up to buffer offset ROF */
+	struct dt_io_ob_ref_s *ref;
+	size_t nref;
+	size_t zref;
+	size_t rof;
+	/* the output ends in the ICP bytes before IP, copied up to IOF */
+	char *ip;
+	size_t icp;
+	size_t iof;
+};
+
+/**
+ * Set up OB to buffer BSZ bytes for FD, or to grow if FD is negative.
+ * Return -1 if the buffer cannot be allocated. */
+extern int dt_io_ob_init(struct dt_io_ob_s *ob, int fd, size_t bsz);
+
+/**
+ * Flush OB, if it has a file descriptor, and free its resources.
+ * Return -1 if any of OB's writes failed. */
+extern int dt_io_ob_fini(struct dt_io_ob_s *ob);
+
+/**
+ * Write everything in OB to its file descriptor. */
+extern int dt_io_ob_flush(struct dt_io_ob_s *ob);
+
+/**
+ * Write the contents of the NOB growing buffers OB to FD in one go
+ * and empty them. */
+extern int dt_io_ob_writev(int fd, struct dt_io_ob_s *ob, size_t nob);
+
+/**
+ * Make room for at least N more bytes in OB, by flushing or growing. */
+extern int __dt_io_ob_room(struct dt_io_ob_s *ob, size_t n);
+
+/**
+ * Queue the N bytes at S as a span, merging it with the preceding
+ * input if possible. */
+extern int __dt_io_ob_ref(struct dt_io_ob_s *ob, char *s, size_t n);
+
+/**
+ * Format D according to FMT and ZONE straight into OB,
+ * appending APND_CH unless it's already there. */
+extern int
+dt_io_ob_write(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, const char *fmt, zif_t zone, int apnd_ch);
+
+/**
+ * Like dt_io_ob_write() for each of the NFMT formats FMT, converting D
+ * to ZONE only once, the renderings are separated by SEP. */
+extern int
+dt_io_ob_write_fmts(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, char *const *fmt, size_t nfmt, zif_t zone,
+	char sep, int apnd_ch);
+
+/**
+ * Put the binary record of D in ZONE, as laid out by BIN, into OB. */
+extern int
+dt_io_ob_write_bin(
+	struct dt_io_ob_s *ob,
+	struct dt_dt_s d, const struct dt_io_bin_s *bin, zif_t zone);
+
+
+static inline void
+dt_io_ob_put(struct dt_io_ob_s *ob, const char *s, size_t n)
+{
+	if (UNLIKELY(ob->len + n > ob->bsz) && __dt_io_ob_room(ob, n) < 0) {
+		return;
+	}
+	memcpy(ob->buf + ob->len, s, n);
+	ob->len += n;
+	return;
+}
+
+static inline void
+dt_io_ob_putc(struct dt_io_ob_s *ob, char c)
+{
+	if (UNLIKELY(ob->len >= ob->bsz) && __dt_io_ob_room(ob, 1U) < 0) {
+		return;
+	}
+	ob->buf[ob->len++] = c;
+	return;
+}
+
+static inline void
+dt_io_ob_ref(struct dt_io_ob_s *ob, char *s, size_t n)
+{
+/* like dt_io_ob_put() but for zero-copy buffers S may be referenced,
+ * it must then stay untouched until OB has been flushed or passed on */
+	if (!ob->zcp || !n) {
+		dt_io_ob_put(ob, s, n);
+	} else if (n >= DT_IO_OB_MINREF || s == ob->ip && ob->len == ob->iof) {
+		/* worth a span, or continuing the previous one */
+		(void)__dt_io_ob_ref(ob, s, n);
+	} else {
+		dt_io_ob_put(ob, s, n);
+		ob->ip = s + n;
+		ob->icp = n;
+		ob->iof = ob->len;
+	}
+	return;
+}
+
+static inline void
+dt_io_ob_unref(struct dt_io_ob_s *ob)
+{
+/* to be called by the driver before the input is refilled, spans must
+ * not outlive the chunk they refer to, and the input copied last must
+ * not be mistaken for the beginning of a span in the next chunk */
+	if (ob->nref) {
+		dt_io_ob_flush(ob);
+	}
+	ob->ip = NULL;
+	ob->icp = 0U;
+	ob->iof = 0U;
+	return;
+}
+
+static inline void
+dt_io_ob_eol(struct dt_io_ob_s *ob)
+{
+/* to be called by the driver after each line */
+	if (UNLIKELY(ob->linep) && (ob->len || ob->nref)) {
+		dt_io_ob_flush(ob);
+	}
+	return;
+}
+
+#endif	/* INCLUDED_dt_io_ob_h_ */
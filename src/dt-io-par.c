@@ -0,0 +1,704 @@
+/*** dt-io-par.c -- order-preserving parallel line processing
+ *
+ * Copyright (C) 2024 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of dateutils.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#if defined HAVE_PTHREAD_H
+# include <pthread.h>
+#endif	/* HAVE_PTHREAD_H */
+#include "dt-core.h"
+#include "dt-io.h"
+#include "dt-io-ob.h"
+#include "dt-io-par.h"
+#include "nifty.h"
+
+/* don't bother spawning threads for fewer lines than this */
+#define MIN_JOB_LINES	(256U)
+/* an upper bound for --jobs */
+#define MAX_NJOBS	(256U)
+/* an upper bound for -k */
+#define MAX_NFLD	(4096U)
+/* an upper bound for --buffer-size */
+#define MAX_OBSZ	(1024U * 1024U * 1024U)
+
+/* line processor state of a worker */
+struct lnp_s {
+	dt_io_par_f f;
+	void *clo;
+	const struct dt_io_par_s *par;
+	/* in field mode F's output is collected here */
+	struct dt_io_ob_s scr;
+};
+
+static int
+lnp_init(
+	struct lnp_s *restrict l,
+	dt_io_par_f f, void *clo, const struct dt_io_par_s *par)
+{
+	*l = (struct lnp_s){.f = f, .clo = clo, .par = par};
+	if (par->fld && UNLIKELY(dt_io_ob_init(&l->scr, -1, 256U) < 0)) {
+		error("Error: cannot allocate field buffer");
+		return -1;
+	}
+	return 0;
+}
+
+static void
+lnp_fini(struct lnp_s *restrict l)
+{
+	(void)dt_io_ob_fini(&l->scr);
+	return;
+}
+
+static void
+lnp_chunk(prch_ctx_t pctx, const struct dt_io_par_s *par)
+{
+/* prepare a freshly filled chunk */
+	if (par->fld) {
+		/* columns up to the field plus one for the rest of the line */
+		prchunk_rechunk(pctx, par->dlm, par->fld + 1);
+	}
+	return;
+}
+
+static int
+lnp_fld(
+	struct lnp_s *restrict l, prch_ctx_t pctx, size_t lno,
+	struct dt_io_ob_s *where)
+{
+/* run F over field FLD of line LNO and splice its output back in */
+	const unsigned int fld = l->par->fld - 1U;
+	const char dlm = l->par->dlm;
+	char *line;
+	size_t llen = prchunk_getlineno(pctx, &line, lno);
+	char *fp;
+	size_t flen = prchunk_getcolno(pctx, &fp, lno, fld);
+	const bool missp = fp == NULL;
+	char *rp;
+	size_t rlen;
+	int rc;
+
+	if (missp) {
+		/* no such field, let F decide over an empty one */
+		fp = line + llen;
+		flen = 0U;
+	}
+	/* undo the rechunker's work left of the field */
+	for (unsigned int i = 0U; i < fld; i++) {
+		char *cp;
+		size_t clen = prchunk_getcolno(pctx, &cp, lno, i);
+
+		if (cp != NULL && cp + clen < line + llen) {
+			cp[clen] = dlm;
+		}
+	}
+	rlen = prchunk_getcolno(pctx, &rp, lno, fld + 1U);
+
+	l->scr.len = 0U;
+	rc = l->f(l->clo, fp, flen, &l->scr);
+	if (l->scr.len == 0U) {
+		/* F wants this line gone */
+		return rc;
+	} else if (l->scr.buf[l->scr.len - 1U] == '\n') {
+		l->scr.len--;
+	}
+
+	if (missp) {
+		/* nothing to splice into */
+		line[llen] = '\n';
+		dt_io_ob_ref(where, line, llen + 1U);
+		return rc;
+	}
+	dt_io_ob_ref(where, line, fp - line);
+	dt_io_ob_put(where, l->scr.buf, l->scr.len);
+	if (rp != NULL) {
+		rp[-1] = dlm;
+		rp[rlen] = '\n';
+		dt_io_ob_ref(where, rp - 1, rlen + 2U);
+	} else {
+		dt_io_ob_putc(where, '\n');
+	}
+	return rc;
+}
+
+static inline int
+lnp_line(
+	struct lnp_s *restrict l, prch_ctx_t pctx, size_t lno,
+	struct dt_io_ob_s *where)
+{
+	char *line;
+	size_t llen;
+
+	if (l->par->fld) {
+		return lnp_fld(l, pctx, lno, where);
+	}
+	llen = prchunk_getlineno(pctx, &line, lno);
+	return l->f(l->clo, line, llen, where);
+}
+
+struct job_s {
+	prch_ctx_t pctx;
+	struct lnp_s *lnp;
+	/* lines [beg, end) */
+	size_t beg;
+	size_t end;
+	/* output */
+	struct dt_io_ob_s *ob;
+	int rc;
+};
+
+static void*
+run_job(void *arg)
+{
+	struct job_s *j = arg;
+
+	for (size_t lno = j->beg; lno < j->end; lno++) {
+		j->rc |= lnp_line(j->lnp, j->pctx, lno, j->ob);
+	}
+	return NULL;
+}
+
+static int
+par_chunk(
+	prch_ctx_t pctx, struct lnp_s *lnp, unsigned int njobs,
+	struct dt_io_ob_s *out)
+{
+/* LNP[0] writes to OUT directly, everyone else to a buffer of their own
+ * which we pass on in one go afterwards */
+	const size_t nl = prchunk_get_nlines(pctx);
+	int rc = 0;
+
+	if (nl / MIN_JOB_LINES + 1U < njobs) {
+		/* not worth it */
+		njobs = nl / MIN_JOB_LINES + 1U;
+	}
+	with (struct job_s jobs[njobs]) {
+		struct dt_io_ob_s ob[njobs];
+#if defined HAVE_PTHREAD_H
+		pthread_t thr[njobs];
+#endif	/* HAVE_PTHREAD_H */
+
+		for (unsigned int i = 0U; i < njobs; i++) {
+			jobs[i] = (struct job_s){
+				.pctx = pctx,
+				.lnp = lnp + i,
+				.beg = nl * i / njobs,
+				.end = nl * (i + 1U) / njobs,
+				.ob = i ? ob + i : out,
+			};
+			if (i && UNLIKELY(dt_io_ob_init(ob + i, -1, 0U) < 0)) {
+				error("Error: cannot allocate output buffer");
+				/* the previous job will have to do the rest */
+				jobs[i - 1U].end = nl;
+				njobs = i;
+				break;
+			}
+			/* the chunk stays put until we've written OB */
+			ob[i].zcp = out->zcp;
+		}
+#if defined HAVE_PTHREAD_H
+		/* job 0 is run by us */
+		for (unsigned int i = 1U; i < njobs; i++) {
+			if (pthread_create(thr + i, NULL, run_job, jobs + i)) {
+				/* do it ourselves then */
+				thr[i] = pthread_self();
+				run_job(jobs + i);
+			}
+		}
+		run_job(jobs + 0U);
+		for (unsigned int i = 1U; i < njobs; i++) {
+			if (!pthread_equal(thr[i], pthread_self())) {
+				pthread_join(thr[i], NULL);
+			}
+		}
+#else  /* !HAVE_PTHREAD_H */
+		for (unsigned int i = 0U; i < njobs; i++) {
+			run_job(jobs + i);
+		}
+#endif	/* HAVE_PTHREAD_H */
+
+		/* collect the results, in order */
+		for (unsigned int i = 0U; i < njobs; i++) {
+			rc |= jobs[i].rc;
+		}
+		if (njobs > 1U) {
+			dt_io_ob_flush(out);
+			if (dt_io_ob_writev(out->fd, ob + 1U, njobs - 1U) < 0) {
+				out->errp = true;
+			}
+		}
+		for (unsigned int i = 1U; i < njobs; i++) {
+			(void)dt_io_ob_fini(ob + i);
+		}
+	}
+	return rc;
+}
+
+static int
+open_file(const char *fn)
+{
+	if (fn == NULL || fn[0U] == '-' && fn[1U] == '\0') {
+		/* stdin then innit */
+		return STDIN_FILENO;
+	}
+	return open(fn, O_RDONLY);
+}
+
+static prch_ctx_t
+open_prchunk(const char *fn, int *fdp, bool rahp)
+{
+	prch_ctx_t pctx;
+	int fd;
+
+	if ((*fdp = fd = open_file(fn)) < 0) {
+		serror("Error: cannot open file `%s'", fn);
+		return NULL;
+	}
+	/* using the prchunk reader now, it gives the fadvice */
+	if ((pctx = init_prchunk(fd)) == NULL) {
+		serror("Error: cannot read from `%s'", fn ?: "<stdin>");
+		if (fd > STDIN_FILENO) {
+			close(fd);
+		}
+		return NULL;
+	}
+	if (rahp) {
+		/* best effort, it's plain reads otherwise */
+		(void)prchunk_readahead(pctx);
+	}
+	return pctx;
+}
+
+static int
+close_prchunk(prch_ctx_t pctx, int fd, const char *fn)
+{
+/* return -1 if the input didn't end the way it should have */
+	const int e = prchunk_error(pctx);
+
+	if (UNLIKELY(e < 0)) {
+		error("Error: corrupt or truncated compressed input in `%s'",
+		      fn ?: "<stdin>");
+	} else if (UNLIKELY(e > 0)) {
+		errno = e;
+		serror("Error: cannot read from `%s'", fn ?: "<stdin>");
+	}
+	free_prchunk(pctx);
+	if (fd > STDIN_FILENO) {
+		close(fd);
+	}
+	return e ? -1 : 0;
+}
+
+static int
+proc_file(
+	const char *fn, struct lnp_s *lnp, unsigned int njobs,
+	struct dt_io_ob_s *out)
+{
+	prch_ctx_t pctx;
+	int fd;
+	int rc = 0;
+
+	if ((pctx = open_prchunk(fn, &fd, lnp->par->rahp)) == NULL) {
+		return -1;
+	}
+	while (prchunk_fill(pctx) >= 0) {
+		const size_t nl = prchunk_get_nlines(pctx);
+
+		lnp_chunk(pctx, lnp->par);
+		if (njobs > 1U) {
+			rc |= par_chunk(pctx, lnp, njobs, out);
+			dt_io_ob_eol(out);
+		} else {
+			for (size_t lno = 0U; lno < nl; lno++) {
+				rc |= lnp_line(lnp, pctx, lno, out);
+				dt_io_ob_eol(out);
+			}
+		}
+		/* OUT may refer to the chunk, get rid of that before refill */
+		dt_io_ob_unref(out);
+	}
+	if (close_prchunk(pctx, fd, fn) < 0) {
+		rc = -1;
+	}
+	return rc;
+}
+
+#if defined HAVE_PTHREAD_H
+struct fres_s {
+	/* where the output of this file has been spooled to */
+	FILE *spool;
+	int rc;
+	bool donep;
+};
+
+struct fjob_s {
+	char *const *fn;
+	size_t nfn;
+	/* per-file results in ordered mode, NULL otherwise */
+	struct fres_s *res;
+	/* stdout */
+	struct dt_io_ob_s *out;
+
+	/* everything below is guarded by MTX */
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;
+	/* the next file to hand out */
+	size_t next;
+	int rc;
+};
+
+struct fwrk_s {
+	struct fjob_s *j;
+	struct lnp_s *lnp;
+};
+
+static void*
+run_fjob(void *arg)
+{
+	const struct fwrk_s *w = arg;
+	struct fjob_s *j = w->j;
+	struct dt_io_ob_s ob = {.fd = -1};
+	int wrc = 0;
+
+	if (j->res == NULL && UNLIKELY(dt_io_ob_init(&ob, -1, 0U) < 0)) {
+		error("Error: cannot allocate output buffer");
+		wrc = -1;
+		goto out;
+	}
+	for (size_t i;;) {
+		prch_ctx_t pctx;
+		FILE *spool = NULL;
+		int fd;
+		int rc = 0;
+
+		pthread_mutex_lock(&j->mtx);
+		i = j->next++;
+		pthread_mutex_unlock(&j->mtx);
+		if (i >= j->nfn) {
+			break;
+		}
+
+		if (j->res != NULL &&
+		    (UNLIKELY((spool = tmpfile()) == NULL) ||
+		     UNLIKELY(dt_io_ob_init(&ob, fileno(spool), 0U) < 0))) {
+			serror("Error: cannot spool output of `%s'", j->fn[i]);
+			rc = -1;
+			goto done;
+		}
+		ob.zcp = j->out->zcp;
+		pctx = open_prchunk(j->fn[i], &fd, w->lnp->par->rahp);
+		if (pctx == NULL) {
+			rc = -1;
+			goto done;
+		}
+		while (prchunk_fill(pctx) >= 0) {
+			const size_t nl = prchunk_get_nlines(pctx);
+
+			lnp_chunk(pctx, w->lnp->par);
+			for (size_t lno = 0U; lno < nl; lno++) {
+				rc |= lnp_line(w->lnp, pctx, lno, &ob);
+			}
+			if (j->res == NULL) {
+				/* pass on the chunk in its entirety */
+				pthread_mutex_lock(&j->mtx);
+				if (dt_io_ob_writev(j->out->fd, &ob, 1U) < 0) {
+					j->out->errp = true;
+				}
+				pthread_mutex_unlock(&j->mtx);
+			} else {
+				/* spans refer to the chunk, spool them now */
+				dt_io_ob_unref(&ob);
+			}
+		}
+		if (close_prchunk(pctx, fd, j->fn[i]) < 0) {
+			rc = -1;
+		}
+	done:
+		if (j->res != NULL) {
+			if (dt_io_ob_fini(&ob) < 0 && rc >= 0) {
+				serror("Error: cannot spool output of `%s'",
+				       j->fn[i]);
+				rc = -1;
+			}
+			pthread_mutex_lock(&j->mtx);
+			j->res[i] = (struct fres_s){spool, rc, true};
+			pthread_cond_broadcast(&j->cnd);
+			pthread_mutex_unlock(&j->mtx);
+		} else if (rc < 0 || wrc < 0) {
+			wrc = -1;
+		} else {
+			wrc |= rc;
+		}
+	}
+	(void)dt_io_ob_fini(&ob);
+out:
+	if (j->res == NULL) {
+		pthread_mutex_lock(&j->mtx);
+		j->rc = j->rc < 0 || wrc < 0 ? -1 : j->rc | wrc;
+		pthread_mutex_unlock(&j->mtx);
+	}
+	return NULL;
+}
+
+static int
+unspool(FILE *spool, struct dt_io_ob_s *out)
+{
+	const int fd = fileno(spool);
+	ssize_t nrd;
+
+	if (lseek(fd, 0, SEEK_SET) < 0) {
+		return -1;
+	}
+	dt_io_ob_flush(out);
+	while ((nrd = read(fd, out->buf, out->bsz)) > 0) {
+		out->len = nrd;
+		dt_io_ob_flush(out);
+	}
+	return nrd < 0 ? -1 : 0;
+}
+
+static int
+par_files(
+	char *const *fn, size_t nfn,
+	struct lnp_s *lnp, unsigned int njobs, bool ordp,
+	struct dt_io_ob_s *out)
+{
+	struct fjob_s j = {
+		.fn = fn,
+		.nfn = nfn,
+		.out = out,
+		.mtx = PTHREAD_MUTEX_INITIALIZER,
+		.cnd = PTHREAD_COND_INITIALIZER,
+	};
+	struct fwrk_s w[njobs];
+	pthread_t thr[njobs];
+	int rc = 0;
+
+	if (ordp && (j.res = calloc(nfn, sizeof(*j.res))) == NULL) {
+		error("Error: cannot allocate output spools");
+		return -1;
+	}
+	/* workers write to OUT's descriptor directly */
+	dt_io_ob_flush(out);
+	for (unsigned int i = 0U; i < njobs; i++) {
+		w[i] = (struct fwrk_s){&j, lnp + i};
+		if (pthread_create(thr + i, NULL, run_fjob, w + i)) {
+			/* do it ourselves then */
+			thr[i] = pthread_self();
+			run_fjob(w + i);
+		}
+	}
+	/* in ordered mode we're the writer */
+	for (size_t i = 0U; ordp && i < nfn; i++) {
+		struct fres_s r;
+
+		pthread_mutex_lock(&j.mtx);
+		while (!j.res[i].donep) {
+			pthread_cond_wait(&j.cnd, &j.mtx);
+		}
+		r = j.res[i];
+		pthread_mutex_unlock(&j.mtx);
+
+		if (r.spool != NULL) {
+			if (UNLIKELY(unspool(r.spool, out) < 0)) {
+				serror("Error: cannot read back output of `%s'",
+				       fn[i]);
+				r.rc = -1;
+			}
+			fclose(r.spool);
+		}
+		rc = rc < 0 || r.rc < 0 ? -1 : rc | r.rc;
+	}
+	for (unsigned int i = 0U; i < njobs; i++) {
+		if (!pthread_equal(thr[i], pthread_self())) {
+			pthread_join(thr[i], NULL);
+		}
+	}
+	if (ordp) {
+		free(j.res);
+	} else {
+		rc = j.rc;
+	}
+	pthread_mutex_destroy(&j.mtx);
+	pthread_cond_destroy(&j.cnd);
+	return rc;
+}
+#endif	/* HAVE_PTHREAD_H */
+
+int
+dt_io_par_files(
+	char *const *fn, size_t nfn,
+	dt_io_par_f f, void *const *clos, const struct dt_io_par_s *par)
+{
+	const unsigned int njobs = par->njobs ?: 1U;
+	struct lnp_s lnp[njobs];
+	struct dt_io_ob_s out;
+	unsigned int i = 0U;
+	int rc = -1;
+
+	/* whatever's in stdio's buffer goes first */
+	fflush(stdout);
+	if (UNLIKELY(dt_io_ob_init(&out, STDOUT_FILENO, par->obsz) < 0)) {
+		error("Error: cannot allocate output buffer");
+		return -1;
+	}
+	out.linep = par->linep || isatty(STDOUT_FILENO);
+	/* unmodified input is written straight from the chunk */
+	out.zcp = true;
+
+	for (; i < njobs; i++) {
+		if (lnp_init(lnp + i, f, clos[i], par) < 0) {
+			goto out;
+		}
+	}
+	if (nfn == 0U) {
+		/* just stdin */
+		rc = proc_file(NULL, lnp, njobs, &out);
+		goto out;
+	}
+#if defined HAVE_PTHREAD_H
+	if (nfn > 1U && njobs > 1U) {
+		/* one file per job */
+		rc = par_files(
+			fn, nfn, lnp, njobs < nfn ? njobs : nfn, par->ordp,
+			&out);
+		goto out;
+	}
+#endif	/* HAVE_PTHREAD_H */
+	rc = 0;
+	for (size_t k = 0U; k < nfn; k++) {
+		int frc = proc_file(fn[k], lnp, njobs, &out);
+
+		rc = rc < 0 || frc < 0 ? -1 : rc | frc;
+	}
+out:
+	while (i-- > 0U) {
+		lnp_fini(lnp + i);
+	}
+	if (dt_io_ob_fini(&out) < 0) {
+		serror("Error: cannot write output");
+		rc = -1;
+	}
+	return rc;
+}
+
+int
+dt_io_par_field(struct dt_io_par_s *par, const char *dlm, const char *fld)
+{
+	if (dlm != NULL) {
+		char buf[8U];
+
+		/* allow \t and friends */
+		strncpy(buf, dlm, sizeof(buf) - 1U);
+		buf[sizeof(buf) - 1U] = '\0';
+		dt_io_unescape(buf);
+		if (buf[0U] == '\0' || buf[1U] != '\0' || buf[0U] == '\n') {
+			error("Error: delimiter must be a single character");
+			return -1;
+		}
+		par->dlm = buf[0U];
+	} else {
+		/* like cut(1) */
+		par->dlm = '\t';
+	}
+	if (fld != NULL) {
+		char *on;
+		long int k = strtol(fld, &on, 10);
+
+		if (*on || k <= 0 || k > (long int)MAX_NFLD) {
+			error("Error: invalid field number `%s'", fld);
+			return -1;
+		}
+		par->fld = (unsigned int)k;
+	}
+	return 0;
+}
+
+int
+dt_io_par_obsz(struct dt_io_par_s *par, const char *arg)
+{
+	char *on;
+	unsigned long int z = strtoul(arg, &on, 10);
+
+	switch (*on) {
+	case 'k':
+	case 'K':
+		z *= 1024U;
+		on++;
+		break;
+	case 'M':
+		z *= 1024U * 1024U;
+		on++;
+		break;
+	default:
+		break;
+	}
+	if (*on || z > MAX_OBSZ) {
+		error("Error: invalid buffer size `%s'", arg);
+		return -1;
+	}
+	/* 0 means line buffered */
+	par->obsz = z;
+	par->linep = !z;
+	return 0;
+}
+
+unsigned int
+dt_io_par_njobs(long int arg)
+{
+	if (arg <= 0) {
+#if defined _SC_NPROCESSORS_ONLN
+		arg = sysconf(_SC_NPROCESSORS_ONLN);
+#endif	/* _SC_NPROCESSORS_ONLN */
+	}
+	if (arg <= 1) {
+		return 1U;
+	} else if (arg > (long int)MAX_NJOBS) {
+		arg = MAX_NJOBS;
+	}
+	/* prime the `now' singletons, they aren't thread-safe */
+	(void)dt_datetime((dt_dttyp_t)DT_YMD);
+	return (unsigned int)arg;
+}
+
+/* dt-io-par.c ends here */
@@ -0,0 +1,106 @@
+/*** dt-io-par.h -- order-preserving parallel line processing
+ *
+ * Copyright (C) 2024 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of dateutils.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_dt_io_par_h_
+#define INCLUDED_dt_io_par_h_
+
+#include <stdbool.h>
+#include "prchunk.h"
+#include "dt-io-ob.h"
+
+/**
+ * Line processor, called with the closure of the worker, the line and
+ * its length, everything the line produces must go to WHERE.
+ * The result is OR'd into the result of dt_io_par_files(). */
+typedef int(*dt_io_par_f)(
+	void *clo, char *line, size_t llen, struct dt_io_ob_s *where);
+
+/**
+ * How to go about the input. */
+struct dt_io_par_s {
+	/* number of workers, as returned by dt_io_par_njobs() */
+	unsigned int njobs;
+	/* whether output of several files follows the order of the files */
+	bool ordp;
+	/* field mode, if non-0 only field FLD (counting from 1) of lines
+	 * delimited by DLM is given to the line processor and its output,
+	 * sans newline, replaces the field, no output drops the line */
+	unsigned int fld;
+	char dlm;
+	/* size of the stdout buffer, 0 for the default, and whether
+	 * to flush it after every line, default is to do so on ttys */
+	size_t obsz;
+	bool linep;
+	/* read input ahead while processing, see prchunk_readahead() */
+	bool rahp;
+};
+
+/**
+ * Process the NFN files FN (stdin if NFN is 0, `-' denotes stdin too)
+ * line by line with F and the closures CLOS of PAR->NJOBS workers.
+ * A single file is processed chunk by chunk, the lines of each chunk
+ * split among the workers and their outputs written in the order of
+ * the lines, several files are handed out to the workers one file per
+ * job.
+ * If PAR->ORDP the output appears in the order of FN, otherwise whole
+ * chunks of different files are written as soon as they are done.
+ * All output goes through one buffer on stdout, see PAR->OBSZ.
+ * Return the OR'd results of F or a negative value if a file could
+ * not be read or the output could not be written. */
+extern int
+dt_io_par_files(
+	char *const *fn, size_t nfn,
+	dt_io_par_f f, void *const *clos, const struct dt_io_par_s *par);
+
+/**
+ * Set up field mode in PAR from the arguments of -t DLM and -k FLD,
+ * either of which may be NULL.  DLM defaults to TAB.
+ * Return -1 if the arguments make no sense. */
+extern int
+dt_io_par_field(struct dt_io_par_s *par, const char *dlm, const char *fld);
+
+/**
+ * Set up the output buffer size in PAR from ARG, a number of bytes
+ * optionally suffixed with k or M, 0 meaning line buffered.
+ * Return -1 if ARG makes no sense. */
+extern int dt_io_par_obsz(struct dt_io_par_s *par, const char *arg);
+
+/**
+ * Return the number of jobs to use for a --jobs argument of ARG,
+ * 0 meaning one job per online CPU. */
+extern unsigned int dt_io_par_njobs(long int arg);
+
+#endif	/* INCLUDED_dt_io_par_h_ */
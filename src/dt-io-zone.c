@@ -37,6 +37,7 @@
 #if defined HAVE_CONFIG_H
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include "tzmap.h"
@@ -215,4 +216,25 @@ dt_io_clear_zones(void)
 	return;
 }
 
+zif_t
+dt_io_zone_dup(zif_t z)
+{
+/* zones cache the last transition they looked up, give every thread
+ * its own copy */
+	if (z == NULL) {
+		return NULL;
+	}
+	return zif_copy(z);
+}
+
+void
+dt_io_zone_free(zif_t z)
+{
+/* copies are always malloc()ed, even those of the coordinated zones */
+	if (z != NULL) {
+		free(z);
+	}
+	return;
+}
+
 /* dt-io-zone.c ends here */
@@ -43,4 +43,8 @@ extern zif_t dt_io_zone(const char *spec);
 
 extern void dt_io_clear_zones(void);
 
+/* private copies of zones for use in worker threads */
+extern zif_t dt_io_zone_dup(zif_t z);
+extern void dt_io_zone_free(zif_t z);
+
 #endif	/* INCLUDED_dt_io_zone_h_ */
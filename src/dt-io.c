@@ -13,6 +13,9 @@
 #include <strings.h>
 #include <stdarg.h>
 #include <errno.h>
+#if defined __AVX2__ || defined __SSE2__
+# include <immintrin.h>
+#endif	/* __AVX2__ || __SSE2__ */
 #include "dt-core.h"
 #include "dt-core-tz-glue.h"
 #include "date-core-private.h"
@@ -41,11 +44,15 @@ error(const char *fmt, ...)
 {
 	va_list vap;
 	va_start(vap, fmt);
+	/* stderr is unbuffered, hold it for the whole message lest
+	 * parallel jobs tear it apart */
+	flockfile(stderr);
 	fputs(prog, stderr);
 	fputs(": ", stderr);
 	vfprintf(stderr, fmt, vap);
 	va_end(vap);
 	fputc('\n', stderr);
+	funlockfile(stderr);
 	return;
 }
 
@@ -53,18 +60,22 @@ void
 __attribute__((format(printf, 1, 2)))
 serror(const char *fmt, ...)
 {
+	/* before any of the calls below gets to clobber it */
+	const int e = errno;
 	va_list vap;
 	va_start(vap, fmt);
+	flockfile(stderr);
 	fputs(prog, stderr);
 	fputs(": ", stderr);
 	vfprintf(stderr, fmt, vap);
 	va_end(vap);
-	if (errno) {
+	if (e) {
 		fputc(':', stderr);
 		fputc(' ', stderr);
-		fputs(strerror(errno), stderr);
+		fputs(strerror(e), stderr);
 	}
 	fputc('\n', stderr);
+	funlockfile(stderr);
 	return;
 }
 
@@ -89,6 +100,330 @@ dt_io_strpdt_special(const char *str)
 	return STRPDT_UNK;
 }
 
+/* the input formats compiled by dt_io_comp_fmts() */
+#define IFMT_MAX_MTF	(64U)
+
+static struct {
+	char *const *fmt;
+	size_t nfmt;
+	dt_strpdt_prog_t *prog;
+	/* for each format the set of earlier formats that might match
+	 * the same strings, NULL if there's too many formats to reorder */
+	uint64_t *ovl;
+	/* matches per format */
+	size_t *hits;
+	/* all formats in one trie, if they share prefixes */
+	dt_strpdt_trie_t trie;
+	/* candidates ruled out by their shape */
+	size_t nshp;
+	/* whether to memoise prefixes, and the memos of all threads */
+	bool memo;
+	struct __memo_s *memos;
+	/* bumped whenever the formats change */
+	size_t gen;
+} ifmts;
+
+struct __memo_s {
+	struct __memo_s *next;
+	dt_strpdt_memo_t m;
+};
+
+/* per-thread memo of the formats of generation GEN, and the last zone
+ * conversion, LOC in zone Z being RES */
+static __thread struct {
+	size_t gen;
+	dt_strpdt_memo_t m;
+	zif_t z;
+	struct dt_dt_s loc;
+	struct dt_dt_s res;
+} memo;
+
+/* the output formats compiled by dt_io_comp_ofmts() */
+static struct {
+	const char **fmt;
+	size_t nfmt;
+	dt_strfdt_prog_t *prog;
+	/* whether to memoise printed prefixes, and the memos of all threads */
+	bool memo;
+	struct __omemo_s *memos;
+	/* bumped whenever the formats change */
+	size_t gen;
+} ofmts;
+
+struct __omemo_s {
+	struct __omemo_s *next;
+	dt_strfdt_memo_t m;
+};
+
+/* per-thread memo of the output formats of generation GEN */
+static __thread struct {
+	size_t gen;
+	dt_strfdt_memo_t m;
+} omemo;
+
+/* per-thread order in which to try formats, move-to-front style */
+static __thread struct {
+	const dt_strpdt_prog_t *prog;
+	size_t n;
+	uint8_t ord[IFMT_MAX_MTF];
+} mtf;
+
+static inline const dt_strpdt_prog_t*
+__ifmt_progs(char *const *fmt)
+{
+	return LIKELY(fmt == ifmts.fmt) ? ifmts.prog : NULL;
+}
+
+static inline void
+__ifmt_hit(size_t i)
+{
+	if (UNLIKELY(ifmts.hits != NULL)) {
+		__atomic_fetch_add(ifmts.hits + i, 1U, __ATOMIC_RELAXED);
+	}
+	return;
+}
+
+static void
+__ifmt_hit_prog(dt_strpdt_prog_t pr)
+{
+	size_t i;
+
+	for (i = 0U; i < ifmts.nfmt; i++) {
+		if (ifmts.prog[i] == pr) {
+			__ifmt_hit(i);
+			break;
+		}
+	}
+	return;
+}
+
+static dt_strpdt_memo_t
+__ifmt_memo(void)
+{
+	struct __memo_s *x;
+
+	if (LIKELY(memo.gen == ifmts.gen)) {
+		return memo.m;
+	}
+	/* formats changed, start afresh */
+	memo.gen = ifmts.gen;
+	memo.m = NULL;
+	memo.z = NULL;
+	if (UNLIKELY((x = malloc(sizeof(*x))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((x->m = dt_make_strpdt_memo()) == NULL)) {
+		free(x);
+		return NULL;
+	}
+	/* hand it to dt_io_free_fmts() */
+	x->next = __atomic_load_n(&ifmts.memos, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(
+		       &ifmts.memos, &x->next, x, true,
+		       __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	return memo.m = x->m;
+}
+
+static inline struct dt_dt_s
+__strpdt_run(const char *str, dt_strpdt_prog_t pr, char **ep)
+{
+	if (UNLIKELY(ifmts.memo)) {
+		return dt_strpdt_memo_run(str, pr, __ifmt_memo(), ep);
+	}
+	return dt_strpdt_run(str, pr, ep);
+}
+
+static inline struct dt_dt_s
+__forgetz(struct dt_dt_s d, zif_t zone)
+{
+	if (UNLIKELY(ifmts.memo) && zone != NULL && !dt_unk_p(d)) {
+		/* make sure the memo is of this generation */
+		(void)__ifmt_memo();
+		/* bitwise equality is enough to reuse the last result */
+		if (memo.z == zone && !memcmp(&d, &memo.loc, sizeof(d))) {
+			return memo.res;
+		}
+		memo.z = zone;
+		memo.loc = d;
+		return memo.res = dtz_forgetz(d, zone);
+	}
+	return dtz_forgetz(d, zone);
+}
+
+static struct dt_dt_s
+__strpdt_mtf(const char *str, char **ep)
+{
+/* try formats most recently matched first, command-line order decides
+ * among formats that match, so whenever the winner might overlap with
+ * earlier formats not tried yet those are tried now */
+	const dt_strpdt_prog_t *pp = ifmts.prog;
+	const size_t nfmt = ifmts.nfmt;
+	struct dt_dt_s res = {DT_UNK};
+	uint64_t tried = 0U;
+	size_t i, j;
+
+	if (UNLIKELY(mtf.prog != pp || mtf.n != nfmt)) {
+		for (j = 0U; j < nfmt; j++) {
+			mtf.ord[j] = (uint8_t)j;
+		}
+		mtf.prog = pp;
+		mtf.n = nfmt;
+	}
+	for (j = 0U; j < nfmt; j++) {
+		i = mtf.ord[j];
+		if (!dt_unk_p(res = __strpdt_run(str, pp[i], ep))) {
+			goto found;
+		}
+		tried |= 1ULL << i;
+	}
+	return res;
+
+found:
+	for (uint64_t chk = ifmts.ovl[i] & ~tried; chk; chk &= chk - 1U) {
+		const size_t k = __builtin_ctzll(chk);
+		struct dt_dt_s d;
+		char *e;
+
+		if (!dt_unk_p(d = __strpdt_run(str, pp[k], &e))) {
+			res = d;
+			if (ep != NULL) {
+				*ep = e;
+			}
+			/* find K's slot */
+			for (j = 0U; mtf.ord[j] != k; j++);
+			i = k;
+			break;
+		}
+	}
+	/* move I to the front */
+	memmove(mtf.ord + 1U, mtf.ord, j * sizeof(*mtf.ord));
+	mtf.ord[0U] = (uint8_t)i;
+	__ifmt_hit(i);
+	return res;
+}
+
+static inline struct dt_dt_s
+__strpdt_pl(const char *str, const struct grpatm_payload_s *f, char **ep)
+{
+	struct dt_dt_s res;
+
+	if (UNLIKELY(f->prog == NULL)) {
+		return dt_strpdt(str, f->fmt, ep);
+	} else if (!dt_unk_p(res = __strpdt_run(str, f->prog, ep)) &&
+		   UNLIKELY(ifmts.hits != NULL)) {
+		__ifmt_hit_prog(f->prog);
+	}
+	return res;
+}
+
+int
+dt_io_comp_fmts(char *const *fmt, size_t nfmt)
+{
+	dt_strpdt_prog_t *pp;
+
+	if (nfmt == 0U) {
+		/* standard formats need no compiling */
+		return 0;
+	} else if (UNLIKELY((pp = calloc(nfmt, sizeof(*pp))) == NULL)) {
+		return -1;
+	}
+	for (size_t i = 0U; i < nfmt; i++) {
+		if (UNLIKELY((pp[i] = dt_compile_strpdt(fmt[i])) == NULL)) {
+			/* out of memory, not the standard formats,
+			 * leave FMT to dt_strpdt() then */
+			while (i-- > 0U) {
+				dt_free_strpdt(pp[i]);
+			}
+			free(pp);
+			return -1;
+		}
+	}
+	dt_io_free_fmts();
+	ifmts.fmt = fmt;
+	ifmts.nfmt = nfmt;
+	ifmts.prog = pp;
+	/* formats with common prefixes are best run as trie */
+	ifmts.trie = dt_strpdt_trie(pp, nfmt);
+	if (ifmts.trie == NULL && nfmt > 1U && nfmt <= IFMT_MAX_MTF &&
+	    (ifmts.ovl = calloc(nfmt, sizeof(*ifmts.ovl))) != NULL) {
+		for (size_t i = 1U; i < nfmt; i++) {
+			for (size_t k = 0U; k < i; k++) {
+				if (!dt_strpdt_disjoint_p(pp[k], pp[i])) {
+					ifmts.ovl[i] |= 1ULL << k;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+void
+dt_io_count_fmts(void)
+{
+	if (ifmts.prog != NULL && ifmts.hits == NULL) {
+		ifmts.hits = calloc(ifmts.nfmt, sizeof(*ifmts.hits));
+	}
+	return;
+}
+
+void
+dt_io_memo_fmts(void)
+{
+	ifmts.memo = true;
+	ofmts.memo = true;
+	return;
+}
+
+void
+dt_io_fmts_stats(void)
+{
+	if (ifmts.hits == NULL) {
+		return;
+	}
+	for (size_t i = 0U; i < ifmts.nfmt; i++) {
+		fprintf(stderr, "%zu\t%s\n", ifmts.hits[i], ifmts.fmt[i]);
+	}
+	if (ifmts.nshp) {
+		fprintf(stderr, "%zu\t(ruled out by shape)\n", ifmts.nshp);
+	}
+	return;
+}
+
+void
+dt_io_free_fmts(void)
+{
+	for (struct __memo_s *x = ifmts.memos, *y; x != NULL; x = y) {
+		y = x->next;
+		dt_free_strpdt_memo(x->m);
+		free(x);
+	}
+	ifmts.memos = NULL;
+	/* have the threads' memos renewed */
+	ifmts.gen++;
+	if (ifmts.prog == NULL) {
+		return;
+	}
+	for (size_t i = 0U; i < ifmts.nfmt; i++) {
+		dt_free_strpdt(ifmts.prog[i]);
+	}
+	free(ifmts.prog);
+	if (ifmts.ovl != NULL) {
+		free(ifmts.ovl);
+	}
+	if (ifmts.hits != NULL) {
+		free(ifmts.hits);
+	}
+	dt_free_strpdt_trie(ifmts.trie);
+	ifmts.fmt = NULL;
+	ifmts.nfmt = 0U;
+	ifmts.prog = NULL;
+	ifmts.ovl = NULL;
+	ifmts.hits = NULL;
+	ifmts.trie = NULL;
+	ifmts.nshp = 0U;
+	ifmts.memo = false;
+	return;
+}
+
 struct dt_dt_s
 dt_io_strpdt(
 	const char *str,
@@ -129,16 +464,8 @@ dt_io_strpdt(
 			break;
 		}
 		return res;
-	} else if (nfmt == 0) {
-		res = dt_strpdt(str, NULL, NULL);
-	} else {
-		for (size_t i = 0; i < nfmt; i++) {
-			if (!dt_unk_p(res = dt_strpdt(str, fmt[i], NULL))) {
-				break;
-			}
-		}
 	}
-	return dtz_forgetz(res, zone);
+	return dt_io_strpdt_ep(str, fmt, nfmt, NULL, zone);
 }
 
 struct dt_dt_s
@@ -148,17 +475,39 @@ dt_io_strpdt_ep(
 	zif_t zone)
 {
 	struct dt_dt_s res = {DT_UNK};
+	const dt_strpdt_prog_t *pp;
 
 	if (nfmt == 0) {
 		res = dt_strpdt(str, NULL, ep);
-	} else {
+	} else if ((pp = __ifmt_progs(fmt)) == NULL) {
 		for (size_t i = 0; i < nfmt; i++) {
 			if (!dt_unk_p(res = dt_strpdt(str, fmt[i], ep))) {
 				break;
 			}
 		}
+	} else if (ifmts.trie != NULL) {
+		const uint64_t all = nfmt < 64U ? (1ULL << nfmt) - 1U : -1ULL;
+		size_t i;
+
+		res = dt_strpdt_trie_run(str, ifmts.trie, all, ep, &i);
+		if (i < nfmt) {
+			__ifmt_hit(i);
+		}
+	} else if (ifmts.ovl != NULL) {
+		res = __strpdt_mtf(str, ep);
+	} else {
+		size_t i;
+
+		for (i = 0; i < nfmt; i++) {
+			if (!dt_unk_p(res = __strpdt_run(str, pp[i], ep))) {
+				break;
+			}
+		}
+		if (i < nfmt) {
+			__ifmt_hit(i);
+		}
 	}
-	return dtz_forgetz(res, zone);
+	return __forgetz(res, zone);
 }
 
 struct dt_dt_s
@@ -181,6 +530,332 @@ dt_io_find_strpdt(
 	return d;
 }
 
+
+/* needle scanning, byte classes are built once in build_needle() and
+ * scanned 64 bytes at a time, yielding all candidates of a block */
+#define CLS_PAGE	(4096U)
+
+/* char classes for needleless specs, names go by the input locale */
+enum {
+	NDL_A,
+	NDL_TA,
+	NDL_B,
+	NDL_TB,
+	NDL_O,
+	NNDL,
+};
+static struct grep_atom_cls_s ndl_cls[NNDL];
+
+static void
+__cls_init(struct grep_atom_cls_s *restrict c, const char *set)
+{
+	uint8_t hbit[16U] = {0U};
+	unsigned int nhi = 0U;
+	unsigned int n = 0U;
+
+	memset(c, 0, sizeof(*c));
+	c->shufp = 1U;
+	for (const unsigned char *s = (const unsigned char*)set; *s; s++) {
+		const unsigned int lo = *s & 0xfU;
+		const unsigned int hi = *s >> 4U;
+
+		if (c->bm[*s >> 6U] >> (*s & 0x3fU) & 1U) {
+			/* seen already */
+			continue;
+		}
+		c->bm[*s >> 6U] |= 1ULL << (*s & 0x3fU);
+		if (n < countof(c->set)) {
+			c->set[n] = (char)*s;
+		}
+		n++;
+		/* one bucket per high nibble, 8 buckets max */
+		if (!hbit[hi] && nhi < 8U) {
+			hbit[hi] = (uint8_t)(1U << nhi++);
+		} else if (!hbit[hi]) {
+			c->shufp = 0U;
+		}
+		c->lo[lo] |= hbit[hi];
+	}
+	memcpy(c->hi, hbit, sizeof(hbit));
+	c->nset = (uint8_t)(n <= countof(c->set) ? n : 0U);
+	return;
+}
+
+static void
+__cls_init_names(
+	struct grep_atom_cls_s *restrict c,
+	const char *const *n1, size_t z1, const char *const *n2, size_t z2)
+{
+/* class of the leading bytes of names N1 and N2, in either case,
+ * the 0-th names are never parsed and left out */
+	const char *const *n[] = {n1, n2};
+	const size_t z[] = {z1, z2};
+	char set[4U * (GREG_MONTHS_P_YEAR + 2U) + 1U];
+	size_t k = 0U;
+
+	for (size_t j = 0U; j < countof(n); j++) {
+		for (size_t i = 1U; i < z[j] && k + 2U < countof(set); i++) {
+			const char x = *n[j][i];
+
+			if (x) {
+				set[k++] = x;
+			}
+			if ((unsigned char)((x | 0x20) - 'a') < 26U) {
+				set[k++] = (char)(x ^ 0x20);
+			}
+		}
+	}
+	set[k] = '\0';
+	__cls_init(c, set);
+	return;
+}
+
+static inline unsigned int
+__cls_p(const struct grep_atom_cls_s *c, char x)
+{
+	const unsigned char u = (unsigned char)x;
+	return c->bm[u >> 6U] >> (u & 0x3fU) & 1U;
+}
+
+#if defined __AVX2__
+# define CLS_SHUF
+static inline uint64_t
+__cls_shuf(const struct grep_atom_cls_s *c, const char *blk)
+{
+	const __m128i lo = _mm_loadu_si128((const __m128i*)c->lo);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)c->hi);
+	const __m256i tlo = _mm256_broadcastsi128_si256(lo);
+	const __m256i thi = _mm256_broadcastsi128_si256(hi);
+	const __m256i nib = _mm256_set1_epi8(0x0f);
+	const __m256i nil = _mm256_setzero_si256();
+	uint64_t m = 0U;
+
+	for (unsigned int i = 0U; i < 2U; i++) {
+		const __m256i x = _mm256_loadu_si256((const __m256i*)blk + i);
+		const __m256i xl = _mm256_and_si256(x, nib);
+		const __m256i xh = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+		const __m256i r = _mm256_and_si256(
+			_mm256_shuffle_epi8(tlo, xl),
+			_mm256_shuffle_epi8(thi, xh));
+		const uint32_t z = (uint32_t)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(r, nil));
+
+		m |= (uint64_t)~z << (32U * i);
+	}
+	return m;
+}
+#elif defined __SSSE3__
+# define CLS_SHUF
+static inline uint64_t
+__cls_shuf(const struct grep_atom_cls_s *c, const char *blk)
+{
+	const __m128i tlo = _mm_loadu_si128((const __m128i*)c->lo);
+	const __m128i thi = _mm_loadu_si128((const __m128i*)c->hi);
+	const __m128i nib = _mm_set1_epi8(0x0f);
+	const __m128i nil = _mm_setzero_si128();
+	uint64_t m = 0U;
+
+	for (unsigned int i = 0U; i < 4U; i++) {
+		const __m128i x = _mm_loadu_si128((const __m128i*)blk + i);
+		const __m128i xl = _mm_and_si128(x, nib);
+		const __m128i xh = _mm_and_si128(_mm_srli_epi16(x, 4), nib);
+		const __m128i r = _mm_and_si128(
+			_mm_shuffle_epi8(tlo, xl),
+			_mm_shuffle_epi8(thi, xh));
+		const uint32_t z = (uint32_t)_mm_movemask_epi8(
+			_mm_cmpeq_epi8(r, nil));
+
+		m |= (uint64_t)(~z & 0xffffU) << (16U * i);
+	}
+	return m;
+}
+#endif	/* __AVX2__ || __SSSE3__ */
+
+#if defined __SSE2__
+# define CLS_CMP
+static inline uint64_t
+__cls_cmp(const struct grep_atom_cls_s *c, const char *blk)
+{
+	const __m128i x0 = _mm_loadu_si128((const __m128i*)blk + 0U);
+	const __m128i x1 = _mm_loadu_si128((const __m128i*)blk + 1U);
+	const __m128i x2 = _mm_loadu_si128((const __m128i*)blk + 2U);
+	const __m128i x3 = _mm_loadu_si128((const __m128i*)blk + 3U);
+	__m128i r0 = _mm_setzero_si128();
+	__m128i r1 = _mm_setzero_si128();
+	__m128i r2 = _mm_setzero_si128();
+	__m128i r3 = _mm_setzero_si128();
+
+	for (unsigned int j = 0U; j < c->nset; j++) {
+		const __m128i k = _mm_set1_epi8(c->set[j]);
+
+		r0 = _mm_or_si128(r0, _mm_cmpeq_epi8(x0, k));
+		r1 = _mm_or_si128(r1, _mm_cmpeq_epi8(x1, k));
+		r2 = _mm_or_si128(r2, _mm_cmpeq_epi8(x2, k));
+		r3 = _mm_or_si128(r3, _mm_cmpeq_epi8(x3, k));
+	}
+	return (uint64_t)(uint32_t)_mm_movemask_epi8(r0) |
+		(uint64_t)(uint32_t)_mm_movemask_epi8(r1) << 16U |
+		(uint64_t)(uint32_t)_mm_movemask_epi8(r2) << 32U |
+		(uint64_t)(uint32_t)_mm_movemask_epi8(r3) << 48U;
+}
+#endif	/* __SSE2__ */
+
+static inline uint64_t
+__cls_blk(const struct grep_atom_cls_s *c, const char *s, size_t n)
+{
+/* bit mask of the bytes in class C among the first min(N, 64) of S */
+	uint64_t m = 0U;
+
+#if defined CLS_SHUF || defined CLS_CMP
+	/* short lines are loaded in full as long as the load stays within
+	 * the page, the bytes past N are masked off */
+	if (LIKELY(n >= 64U) ||
+	    LIKELY(((uintptr_t)s % CLS_PAGE) <= CLS_PAGE - 64U)) {
+		const uint64_t live = n >= 64U ? ~0ULL : (1ULL << n) - 1U;
+
+# if defined CLS_SHUF
+		if (c->shufp) {
+			return __cls_shuf(c, s) & live;
+		}
+# endif	/* CLS_SHUF */
+# if defined CLS_CMP
+		if (c->nset) {
+			return __cls_cmp(c, s) & live;
+		}
+# endif	/* CLS_CMP */
+	}
+#endif	/* CLS_SHUF || CLS_CMP */
+	n = n < 64U ? n : 64U;
+	for (size_t i = 0U; i < n; i++) {
+		m |= (uint64_t)__cls_p(c, s[i]) << i;
+	}
+	return m;
+}
+
+struct __cls_it_s {
+	const struct grep_atom_cls_s *c;
+	const char *s;
+	size_t n;
+	/* offset of the current block and its remaining candidates */
+	size_t o;
+	uint64_t m;
+};
+
+static inline struct __cls_it_s
+__cls_it(const struct grep_atom_cls_s *c, const char *s, size_t n)
+{
+	return (struct __cls_it_s){c, s, n, 0U, __cls_blk(c, s, n)};
+}
+
+static inline const char*
+__cls_next(struct __cls_it_s *restrict it)
+{
+/* next byte in the class, or S + N when there is none */
+	const char *r;
+
+	while (!it->m) {
+		if ((it->o += 64U) >= it->n) {
+			return it->s + it->n;
+		}
+		it->m = __cls_blk(it->c, it->s + it->o, it->n - it->o);
+	}
+	r = it->s + it->o + __builtin_ctzll(it->m);
+	it->m &= it->m - 1U;
+	return r;
+}
+
+static inline uint64_t
+__shp_nondig(uint64_t x)
+{
+/* 0x80 in every byte of X that is not a digit */
+	const uint64_t t = x ^ 0x3030303030303030ULL;
+
+	return (((t & 0x7f7f7f7f7f7f7f7fULL) + 0x7676767676767676ULL) | t) &
+		0x8080808080808080ULL;
+}
+
+static inline bool
+__shape_p(const char *q, const struct grpatm_payload_s *f)
+{
+/* whether Q could start a match of F at all, going by its first 8 bytes,
+ * a NUL fails all byte checks just like it fails the parser */
+	uint64_t x, nd;
+	unsigned int k;
+
+	if (!f->shp ||
+	    UNLIKELY(((uintptr_t)q % CLS_PAGE) > CLS_PAGE - 8U)) {
+		/* 8-byte load might cross into an unmapped page */
+		return true;
+	}
+	memcpy(&x, q, sizeof(x));
+	x = le64toh(x);
+	if (f->shp == GRPATM_SHP_STD && (x & 0xffU) == '@') {
+		/* epoch */
+		return true;
+	} else if (!(nd = __shp_nondig(x))) {
+		/* digit run too long to tell */
+		return true;
+	} else if (!(k = __builtin_ctzll(nd) & ~7U)) {
+		/* no leading digit */
+		return false;
+	}
+	/* first byte past the digit run, and on */
+	x >>= k;
+	if (f->shp == GRPATM_SHP_STD) {
+		/* dates go on with -, times with : */
+		return (uint8_t)x == '-' || (uint8_t)x == ':';
+	}
+	return !((((x ^ f->shpv) & f->shpm) | (__shp_nondig(x) & f->shpd)) &
+		 (~0ULL >> k));
+}
+
+static inline void
+__shp_miss(void)
+{
+	if (UNLIKELY(ifmts.hits != NULL)) {
+		__atomic_fetch_add(&ifmts.nshp, 1U, __ATOMIC_RELAXED);
+	}
+	return;
+}
+
+static inline bool
+__digits_fit_p(const struct grpatm_payload_s *f, size_t n)
+{
+/* whether a digit run of length N fits F's window */
+	return f->flags == GRPATM_DIGITS &&
+		n >= (size_t)(f->off_min > 0 ? f->off_min : 1) &&
+		n <= (size_t)(f->off_max > 0 ? f->off_max : 0);
+}
+
+static struct dt_dt_s
+__find_digits(
+	const char *str, const char *zp,
+	const struct grep_atom_soa_s *needles, size_t i,
+	const char **sp, char **ep)
+{
+/* tokenise [STR, ZP) into digit runs and try the atoms in digits mode,
+ * the I-th and those after it, on runs whose length fits their window,
+ * leftmost run first, point SP to the beginning of the match */
+	const char *needle = needles->needle;
+	struct dt_dt_s d = {DT_UNK};
+
+	for (const char *p = str, *q; p < zp; p = q) {
+		for (; p < zp && (unsigned char)(*p ^ '0') >= 10U; p++);
+		for (q = p; q < zp && (unsigned char)(*q ^ '0') < 10U; q++);
+		for (size_t j = i;
+		     needle[j] == GRPATM_NEEDLELESS_MODE_CHAR; j++) {
+			const struct grpatm_payload_s *f = needles->flesh + j;
+
+			if (__digits_fit_p(f, q - p) &&
+			    !dt_unk_p(d = __strpdt_pl(p, f, ep))) {
+				*sp = p;
+				return d;
+			}
+		}
+	}
+	return d;
+}
+
 struct dt_dt_s
 dt_io_find_strpdt2(
 	const char *str, size_t len,
@@ -192,8 +867,9 @@ dt_io_find_strpdt2(
 	const char *needle = needles->needle;
 	const char *p = str;
 	const char *const zp = str + len;
+	struct __cls_it_s it = __cls_it(&needles->cls, str, len);
 
-	for (; (p = xmempbrk(p, zp - p, needle)) < zp && *p; p++) {
+	while ((p = __cls_next(&it)) < zp) {
 		/* find the offset */
 		const struct grpatm_payload_s *fp;
 		const char *np;
@@ -204,7 +880,6 @@ dt_io_find_strpdt2(
 		 * f is the associated grpatm payload */
 		while (*np++ == *p) {
 			const struct grpatm_payload_s f = *fp++;
-			const char *fmt = f.fmt;
 			const char *q = p + f.off_min;
 			const char *r = p + f.off_max;
 
@@ -212,8 +887,27 @@ dt_io_find_strpdt2(
 				q = str;
 			}
 
+			if (f.grp) {
+				/* formats sharing needle and offset, in one go */
+				const int ng = __builtin_popcountll(f.grp) - 1;
+				size_t k;
+
+				if (q < zp && q <= r &&
+				    !dt_unk_p(d = dt_strpdt_trie_run(
+						      q, ifmts.trie, f.grp,
+						      ep, &k))) {
+					__ifmt_hit(k);
+					p = q;
+					goto found;
+				}
+				np += ng;
+				fp += ng;
+				continue;
+			}
 			for (; q < zp && q <= r; q++) {
-				if (!dt_unk_p(d = dt_strpdt(q, fmt, ep))) {
+				if (!__shape_p(q, &f)) {
+					__shp_miss();
+				} else if (!dt_unk_p(d = __strpdt_pl(q, &f, ep))) {
 					p = q;
 					goto found;
 				}
@@ -221,46 +915,35 @@ dt_io_find_strpdt2(
 		}
 	}
 	/* otherwise check character classes */
-	for (size_t i = 0; needle[i] == GRPATM_NEEDLELESS_MODE_CHAR; i++) {
+	for (size_t i = 0, digp = 0U;
+	     needle[i] == GRPATM_NEEDLELESS_MODE_CHAR; i++) {
 		struct grpatm_payload_s f = needles->flesh[i];
-		const char *fmt = f.fmt;
-		const char *ndl;
+		const struct grep_atom_cls_s *ndl;
 
 		/* look out for char classes*/
 		switch (f.flags) {
-			/* this isn't the bestest of approaches as it involves
-			 * details about the contents behind the specifiers */
-			static const char a_needle[] = "FMSTWfmstw";
-			static const char ta_needle[] = "MTWRFAS";
-			static const char b_needle[] = "ADFJMNOSadfjmnos";
-			static const char tb_needle[] = "FGHJKMNQUVXZ";
-			static const char o_needle[] = "CDILMVXcdilmvx";
-
 		case GRPATM_A_SPEC:
-			ndl = a_needle;
-			break;
-		case GRPATM_B_SPEC:
-			ndl = b_needle;
+			ndl = ndl_cls + NDL_A;
 			break;
 		case GRPATM_TA_SPEC:
-			ndl = ta_needle;
+			ndl = ndl_cls + NDL_TA;
+			break;
+		case GRPATM_B_SPEC:
+			ndl = ndl_cls + NDL_B;
 			break;
 		case GRPATM_TB_SPEC:
-			ndl = tb_needle;
+			ndl = ndl_cls + NDL_TB;
 			break;
 		case GRPATM_O_SPEC:
-			ndl = o_needle;
+			ndl = ndl_cls + NDL_O;
 			break;
 
 		case GRPATM_DIGITS:
-			/* yay, look for all digits */
-			for (p = str; p < zp && !(*p >= '0' && *p <= '9'); p++);
-			for (const char *q = p;
-			     q < zp && *q >= '0' && *q <= '9'; q++) {
-				if ((--f.off_min <= 0) &&
-				    !dt_unk_p(d = dt_strpdt(p, fmt, ep))) {
-					goto found;
-				}
+			/* yay, look for all digits, all atoms in one go */
+			if (!digp++ &&
+			    !dt_unk_p(d = __find_digits(
+					      str, zp, needles, i, &p, ep))) {
+				goto found;
 			}
 			continue;
 
@@ -291,7 +974,7 @@ dt_io_find_strpdt2(
 					goto bugger;
 				}
 				if ((--f.off_min <= 0) &&
-				    !dt_unk_p(d = dt_strpdt(p, fmt, ep))) {
+				    !dt_unk_p(d = __strpdt_pl(p, &f, ep))) {
 					goto found;
 				}
 			}
@@ -300,12 +983,12 @@ dt_io_find_strpdt2(
 			continue;
 		}
 		/* not reached unless ndl is set */
-		for (p = str; (p = xmempbrk(p, zp - p, ndl)) < zp && *p; p++) {
+		for (it = __cls_it(ndl, str, len); (p = __cls_next(&it)) < zp;) {
 			if (p + f.off_min < str || p + f.off_max > zp) {
 				continue;
 			}
 			for (int8_t j = f.off_min; j <= f.off_max; j++) {
-				if (!dt_unk_p(d = dt_strpdt(p + j, fmt, ep))) {
+				if (!dt_unk_p(d = __strpdt_pl(p + j, &f, ep))) {
 					p += j;
 					goto found;
 				}
@@ -316,13 +999,119 @@ dt_io_find_strpdt2(
 	*ep = (char*)(p = str);
 found:
 	*sp = (char*)p;
-	return dtz_forgetz(d, zone);
+	return __forgetz(d, zone);
+}
+
+static dt_strfdt_memo_t
+__ofmt_memo(void)
+{
+	struct __omemo_s *x;
+
+	if (LIKELY(omemo.gen == ofmts.gen)) {
+		return omemo.m;
+	}
+	/* format changed, start afresh */
+	omemo.gen = ofmts.gen;
+	omemo.m = NULL;
+	if (UNLIKELY((x = malloc(sizeof(*x))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((x->m = dt_make_strfdt_memo()) == NULL)) {
+		free(x);
+		return NULL;
+	}
+	/* hand it to dt_io_free_ofmts() */
+	x->next = __atomic_load_n(&ofmts.memos, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(
+		       &ofmts.memos, &x->next, x, true,
+		       __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	return omemo.m = x->m;
+}
+
+int
+dt_io_comp_ofmts(char *const *fmt, size_t nfmt)
+{
+	dt_strfdt_prog_t *pp;
+	const char **fp;
+
+	if (nfmt == 0U) {
+		return 0;
+	} else if (UNLIKELY((pp = calloc(
+				     nfmt, sizeof(*pp) + sizeof(*fp))) == NULL)) {
+		return -1;
+	}
+	fp = (void*)(pp + nfmt);
+	for (size_t i = 0U; i < nfmt; i++) {
+		if (UNLIKELY((pp[i] = dt_compile_strfdt(fmt[i])) == NULL)) {
+			/* leave it to dt_strfdt() then */
+			while (i-- > 0U) {
+				dt_free_strfdt(pp[i]);
+			}
+			free(pp);
+			return -1;
+		}
+		fp[i] = fmt[i];
+	}
+	dt_io_free_ofmts();
+	ofmts.fmt = fp;
+	ofmts.nfmt = nfmt;
+	ofmts.prog = pp;
+	return 0;
+}
+
+void
+dt_io_free_ofmts(void)
+{
+	for (struct __omemo_s *x = ofmts.memos, *y; x != NULL; x = y) {
+		y = x->next;
+		dt_free_strfdt_memo(x->m);
+		free(x);
+	}
+	ofmts.memos = NULL;
+	/* have the threads' memos renewed */
+	ofmts.gen++;
+	if (ofmts.prog == NULL) {
+		return;
+	}
+	for (size_t i = 0U; i < ofmts.nfmt; i++) {
+		dt_free_strfdt(ofmts.prog[i]);
+	}
+	/* formats are in the same block */
+	free(ofmts.prog);
+	ofmts.fmt = NULL;
+	ofmts.nfmt = 0U;
+	ofmts.prog = NULL;
+	ofmts.memo = false;
+	return;
+}
+
+size_t
+dt_io_strfdt(
+	char *restrict buf, size_t bsz,
+	const char *fmt, struct dt_dt_s that, int apnd_ch)
+{
+	size_t res;
+	size_t i;
+
+	for (i = 0U; i < ofmts.nfmt && ofmts.fmt[i] != fmt; i++);
+	if (LIKELY(i < ofmts.nfmt)) {
+		res = UNLIKELY(ofmts.memo)
+			? dt_strfdt_memo_run(
+				buf, bsz, ofmts.prog[i], __ofmt_memo(), that)
+			: dt_strfdt_run(buf, bsz, ofmts.prog[i], that);
+	} else {
+		res = dt_strfdt(buf, bsz, fmt, that);
+	}
+	if (LIKELY(res > 0) && apnd_ch && buf[res - 1] != apnd_ch) {
+		/* auto-newline */
+		buf[res++] = (char)apnd_ch;
+	}
+	return res;
 }
 
 int
 dt_io_write(struct dt_dt_s d, const char *fmt, zif_t zone, int apnd_ch)
 {
-	static char buf[256];
+	char buf[256];
 	size_t n;
 
 	if (zone != NULL) {
@@ -337,8 +1126,251 @@ dt_io_write(struct dt_dt_s d, const char *fmt, zif_t zone, int apnd_ch)
 	return (n > 0) - 1;
 }
 
+int
+dt_io_write_fmts(
+	struct dt_dt_s d, char *const *fmt, size_t nfmt, zif_t zone,
+	char sep, int apnd_ch)
+{
+	char buf[256];
+
+	if (zone != NULL) {
+		d = dtz_enrichz(d, zone);
+	} else {
+		/* zone == NULL is UTC, kill zdiff */
+		d.zdiff = 0U;
+		d.neg = 0U;
+	}
+	for (size_t i = 0U; i + 1U < nfmt; i++) {
+		/* separators go in unconditionally, to keep the columns */
+		size_t n = dt_io_strfdt(buf, sizeof(buf) - 1U, fmt[i], d, '\0');
+
+		buf[n++] = sep;
+		__io_write(buf, n, stdout);
+	}
+	with (size_t n) {
+		n = dt_io_strfdt(buf, sizeof(buf), fmt[nfmt - 1U], d, apnd_ch);
+		__io_write(buf, n, stdout);
+	}
+	return 0;
+}
+
+
+/* binary columnar output */
+#define BIN_NA64	INT64_MIN
+#define BIN_NA32	INT32_MIN
+/* lilian day number of 1970-01-01, as per dconv -f ldn */
+#define BIN_LDN_UNIX	(141427)
+
+enum {
+	BIN_COL_S,
+	BIN_COL_NS,
+	BIN_COL_LDN,
+	BIN_COL_Z,
+	NBIN_COLS,
+};
+
+static const struct {
+	/* names and numpy type strings, as they go into the header */
+	char name[8U];
+	char typ[8U];
+	uint8_t wid;
+} bin_cols[NBIN_COLS] = {
+	[BIN_COL_S] = {"s", "<i8", 8U},
+	[BIN_COL_NS] = {"ns", "<i8", 8U},
+	[BIN_COL_LDN] = {"ldn", "<i4", 4U},
+	[BIN_COL_Z] = {"z", "<i4", 4U},
+};
+
+static inline char*
+__bin_put(char *restrict bp, uint64_t x, size_t n)
+{
+/* store the N lower bytes of X at BP, little-endian */
+	for (size_t i = 0U; i < n; i++) {
+		bp[i] = (char)(x >> (8U * i));
+	}
+	return bp + n;
+}
+
+int
+dt_io_bin_cols(struct dt_io_bin_s *bin, const char *spec)
+{
+	const char *sp = spec;
+
+	bin->ncol = 0U;
+	bin->rsz = 0U;
+	do {
+		const char *ep = strchr(sp, ',') ?: sp + strlen(sp);
+		const size_t n = ep - sp;
+		size_t c;
+
+		for (c = 0U; c < NBIN_COLS; c++) {
+			if (n < sizeof(bin_cols[c].name) &&
+			    !strncmp(sp, bin_cols[c].name, n) &&
+			    bin_cols[c].name[n] == '\0') {
+				break;
+			}
+		}
+		if (UNLIKELY(c >= NBIN_COLS)) {
+			error("Error: unknown column `%.*s' in `%s'",
+			      (int)n, sp, spec);
+			return -1;
+		} else if (UNLIKELY(bin->ncol >= countof(bin->col))) {
+			error("Error: more than %zu columns in `%s'",
+			      countof(bin->col), spec);
+			return -1;
+		}
+		bin->col[bin->ncol++] = (uint8_t)c;
+		bin->rsz += bin_cols[c].wid;
+		sp = ep + (*ep == ',');
+	} while (*sp);
+	return 0;
+}
+
+size_t
+dt_io_bin_hdr(char *restrict buf, size_t bsz, const struct dt_io_bin_s *bin)
+{
+/* magic, version and number of columns in 8 bytes, then per column
+ * its name and its type, 8 bytes each, so records start aligned */
+	const size_t z = 8U + 16U * bin->ncol;
+	char *bp = buf;
+
+	if (UNLIKELY(bsz < z)) {
+		return 0U;
+	}
+	memcpy(bp, "dtcols", 6U);
+	bp[6U] = '\001';
+	bp[7U] = (char)bin->ncol;
+	bp += 8U;
+	for (size_t i = 0U; i < bin->ncol; i++, bp += 16U) {
+		memcpy(bp, bin_cols[bin->col[i]].name, 8U);
+		memcpy(bp + 8U, bin_cols[bin->col[i]].typ, 8U);
+	}
+	return z;
+}
+
+size_t
+dt_io_bin_rec(
+	char *restrict buf, const struct dt_io_bin_s *bin,
+	struct dt_dt_s d, zif_t zone)
+{
+	char *bp = buf;
+	int64_t s = BIN_NA64;
+	int64_t ns = BIN_NA64;
+	int32_t ldn = BIN_NA32;
+	int32_t z = BIN_NA32;
+
+	if (LIKELY(!dt_unk_p(d))) {
+		/* stored in UTC, so that's the stamp already */
+		s = dt_to_unix_epoch(d);
+		ns = s * 1000000000LL;
+		if (!dt_sandwich_only_d_p(d) && d.typ != DT_SEXY) {
+			ns += d.t.hms.ns;
+		}
+		/* dates stay put, like in dtz_enrichz() */
+		z = zone != NULL && !dt_sandwich_only_d_p(d)
+			? (int32_t)(zif_local_time(zone, s) - s) : 0;
+		/* the day of the local date, rounded towards -inf */
+		with (int64_t l = s + z) {
+			l = l / SECS_PER_DAY - (l % SECS_PER_DAY < 0);
+			ldn = (int32_t)(l + BIN_LDN_UNIX);
+		}
+	}
+	for (size_t i = 0U; i < bin->ncol; i++) {
+		switch (bin->col[i]) {
+		case BIN_COL_S:
+			bp = __bin_put(bp, (uint64_t)s, 8U);
+			break;
+		case BIN_COL_NS:
+			bp = __bin_put(bp, (uint64_t)ns, 8U);
+			break;
+		case BIN_COL_LDN:
+			bp = __bin_put(bp, (uint32_t)ldn, 4U);
+			break;
+		case BIN_COL_Z:
+			bp = __bin_put(bp, (uint32_t)z, 4U);
+			break;
+		default:
+			break;
+		}
+	}
+	return bp - buf;
+}
+
+int
+dt_io_write_bin(struct dt_dt_s d, const struct dt_io_bin_s *bin, zif_t zone)
+{
+	char buf[DT_IO_BIN_MAXCOL * 8U];
+	size_t n;
+
+	n = dt_io_bin_rec(buf, bin, d, zone);
+	return (__io_write(buf, n, stdout) == n) - 1;
+}
+
 
 /* needles for the grep mode */
+static inline bool
+__shp_dig_spec_p(struct dt_spec_s s)
+{
+/* whether S reads a plain digit run, no blanks, signs or suffixes */
+	if (s.ord || s.rom || s.bizda) {
+		return false;
+	}
+	switch (s.spfl) {
+	case DT_SPFL_N_YEAR:
+		/* strtoi32() allows a sign */
+		return s.abbr != DT_SPMOD_ILL;
+	case DT_SPFL_N_MON:
+	case DT_SPFL_N_DCNT_WEEK:
+	case DT_SPFL_N_DCNT_YEAR:
+	case DT_SPFL_N_WCNT_MON:
+	case DT_SPFL_N_HOUR:
+	case DT_SPFL_N_MIN:
+	case DT_SPFL_N_SEC:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+static void
+__grep_atom_shape(struct grpatm_payload_s *restrict pl, const char *fp)
+{
+/* shape of what follows the leading digit run, FP points there */
+	pl->shp = GRPATM_SHP_DIG;
+	pl->shpm = 0U;
+	pl->shpv = 0U;
+	pl->shpd = 0U;
+	for (unsigned int i = 0U; *fp && i < 8U; i++) {
+		const char *fp_sav = fp;
+		struct dt_spec_s spec = __tok_spec(fp_sav, &fp);
+		uint64_t c;
+
+		switch (spec.spfl) {
+		case DT_SPFL_UNK:
+			c = (unsigned char)*fp_sav;
+			break;
+		case DT_SPFL_LIT_PERCENT:
+			c = '%';
+			break;
+		case DT_SPFL_LIT_NL:
+			c = '\n';
+			break;
+		case DT_SPFL_LIT_TAB:
+			c = '\t';
+			break;
+		default:
+			if (__shp_dig_spec_p(spec)) {
+				pl->shpd |= 0x80ULL << (8U * i);
+			}
+			return;
+		}
+		pl->shpm |= 0xffULL << (8U * i);
+		pl->shpv |= c << (8U * i);
+	}
+	return;
+}
+
 struct grep_atom_s
 calc_grep_atom(const char *fmt)
 {
@@ -346,6 +1378,8 @@ calc_grep_atom(const char *fmt)
 	int8_t andl_idx = 0;
 	int8_t bndl_idx = 0;
 	int8_t pndl_idx = 0;
+	/* whether all specs so far read plain digit runs */
+	bool lead;
 
 	/* init */
 	if (fmt == NULL) {
@@ -378,6 +1412,7 @@ calc_grep_atom(const char *fmt)
 	}
 
 	/* rest here ... */
+	lead = *fmt == '%';
 	for (const char *fp = fmt; *fp;) {
 		const char *fp_sav = fp;
 		struct dt_spec_s spec = __tok_spec(fp_sav, &fp);
@@ -406,21 +1441,29 @@ calc_grep_atom(const char *fmt)
 			 * english text, in fact it's more like a haystack
 			 * itself */
 			res.needle = *fp_sav;
-			goto out;
+			goto lit;
 		case DT_SPFL_LIT_PERCENT:
 			/* very good needle character methinks */
 			res.needle = '%';
-			goto out;
+			goto lit;
 		case DT_SPFL_LIT_NL:
 			/* quite good needle characters */
 			res.needle = '\n';
-			goto out;
+			goto lit;
 		case DT_SPFL_LIT_TAB:
 			res.needle = '\t';
-			goto out;
+			goto lit;
 		case DT_SPFL_N_DSTD:
+			if (fp_sav == fmt) {
+				/* a digit run, then any byte, no more to
+				 * say as the year might read 4 digits of 5 */
+				__grep_atom_shape(&res.pl, "");
+			}
 			goto dstd;
 		case DT_SPFL_N_TSTD:
+			if (fp_sav == fmt) {
+				__grep_atom_shape(&res.pl, ":%M");
+			}
 			goto tstd;
 		case DT_SPFL_N_YEAR:
 			switch (spec.abbr) {
@@ -529,6 +1572,17 @@ calc_grep_atom(const char *fmt)
 		default:
 			break;
 		}
+		lead = lead && __shp_dig_spec_p(spec);
+		continue;
+
+	lit:
+		/* a run of digit specs, then a non-digit needle means
+		 * any match has the needle right after the run */
+		if (lead && fp_sav > fmt &&
+		    (unsigned char)(res.needle ^ '0') >= 10U) {
+			__grep_atom_shape(&res.pl, fp_sav);
+		}
+		goto out;
 	}
 
 post_snarf:
@@ -580,6 +1634,8 @@ out:
 	/* finally assign the format */
 	if (res.needle || res.pl.flags) {
 		res.pl.fmt = fmt;
+		res.pl.prog = NULL;
+		res.pl.grp = 0U;
 	}
 	return res;
 }
@@ -588,6 +1644,7 @@ struct grep_atom_soa_s
 build_needle(grep_atom_t atoms, size_t natoms, char *const *fmt, size_t nfmt)
 {
 	struct grep_atom_soa_s res = make_grep_atom_soa(atoms, natoms);
+	const dt_strpdt_prog_t *pp = __ifmt_progs(fmt);
 	struct grep_atom_s a;
 
 	if (nfmt == 0) {
@@ -600,6 +1657,9 @@ build_needle(grep_atom_t atoms, size_t natoms, char *const *fmt, size_t nfmt)
 		res.flesh[idx].off_min = -4;
 		res.flesh[idx].off_max = -4;
 		res.flesh[idx].fmt = NULL;
+		res.flesh[idx].prog = NULL;
+		res.flesh[idx].grp = 0U;
+		res.flesh[idx].shp = GRPATM_SHP_STD;
 
 		/* standard format, %T */
 		idx = res.natoms++;
@@ -607,6 +1667,9 @@ build_needle(grep_atom_t atoms, size_t natoms, char *const *fmt, size_t nfmt)
 		res.flesh[idx].off_min = -2;
 		res.flesh[idx].off_max = -1;
 		res.flesh[idx].fmt = NULL;
+		res.flesh[idx].prog = NULL;
+		res.flesh[idx].grp = 0U;
+		res.flesh[idx].shp = GRPATM_SHP_STD;
 		goto out;
 	}
 	/* otherwise collect needles from all formats */
@@ -627,13 +1690,48 @@ build_needle(grep_atom_t atoms, size_t natoms, char *const *fmt, size_t nfmt)
 					res.flesh + j,
 					(idx - j) * sizeof(*res.flesh));
 			}
+			if (pp != NULL) {
+				a.pl.prog = pp[i];
+				a.pl.grp = ifmts.trie != NULL ? 1ULL << i : 0U;
+			}
 			res.needle[j] = a.needle;
 			res.flesh[j] = a.pl;
 		}
 	}
+	/* consecutive needles of formats in the trie that share the
+	 * offset, a fixed one, are run in one go */
+	for (size_t j = 0U, k; j < res.natoms; j = k) {
+		const struct grpatm_payload_s f = res.flesh[j];
+		uint64_t grp = f.grp;
+
+		for (k = j + 1U; k < res.natoms &&
+			     f.grp && !f.flags && f.off_min == f.off_max &&
+			     res.needle[k] == res.needle[j] &&
+			     res.flesh[k].grp && !res.flesh[k].flags &&
+			     res.flesh[k].off_min == f.off_min &&
+			     res.flesh[k].off_max == f.off_max; k++) {
+			grp |= res.flesh[k].grp;
+			res.flesh[k].grp = 0U;
+		}
+		res.flesh[j].grp = k - j > 1U ? grp : 0U;
+	}
 out:
 	/* terminate needle with \0 */
 	res.needle[res.natoms] = '\0';
+	__cls_init(&res.cls, res.needle);
+	/* this isn't the bestest of approaches as it involves
+	 * details about the contents behind the specifiers */
+	__cls_init_names(
+		ndl_cls + NDL_A,
+		dut_abbr_wday, dut_nabbr_wday,
+		dut_long_wday, dut_nlong_wday);
+	__cls_init(ndl_cls + NDL_TA, dut_abab_wday + 1U);
+	__cls_init_names(
+		ndl_cls + NDL_B,
+		dut_abbr_mon, dut_nabbr_mon,
+		dut_long_mon, dut_nlong_mon);
+	__cls_init(ndl_cls + NDL_TB, dut_abab_mon + 1U);
+	__cls_init(ndl_cls + NDL_O, "CDILMVXcdilmvx");
 	return res;
 }
 
@@ -43,6 +43,19 @@ struct grpatm_payload_s {
 	int8_t off_min;
 	int8_t off_max;
 	const char *fmt;
+	/* FMT compiled, or NULL to interpret FMT */
+	dt_strpdt_prog_t prog;
+	/* formats to run as trie, this and the next popcount-1 needles */
+	uint64_t grp;
+	/* shape of the candidates, checked before parsing them */
+	uint8_t shp;
+#define GRPATM_SHP_DIG	(1U)
+#define GRPATM_SHP_STD	(2U)
+	/* for GRPATM_SHP_DIG, a digit run first, then bytes equal to SHPV
+	 * under SHPM and digits under SHPD, byte 0 is the one past the run */
+	uint64_t shpm;
+	uint64_t shpv;
+	uint64_t shpd;
 };
 
 /* atoms are maps needle-character -> payload */
@@ -52,10 +65,25 @@ struct grep_atom_s {
 	struct grpatm_payload_s pl;
 };
 
+/* byte class of a needle set, built once, scanned per line */
+struct grep_atom_cls_s {
+	/* one bit per byte value */
+	uint64_t bm[4U];
+	/* nibble tables, byte c is in the class iff lo[c & 0xf] & hi[c >> 4] */
+	uint8_t lo[16U];
+	uint8_t hi[16U];
+	/* whether lo/hi are exact, i.e. at most 8 distinct high nibbles */
+	uint8_t shufp;
+	/* distinct bytes of the class, or 0 if more than fit in SET */
+	uint8_t nset;
+	char set[8U];
+};
+
 struct grep_atom_soa_s {
 	size_t natoms;
 	char *needle;
 	struct grpatm_payload_s *flesh;
+	struct grep_atom_cls_s cls;
 };
 
 /* duration parser */
@@ -75,6 +103,30 @@ struct __strpdtdur_st_s {
 
 /* public API */
 extern dt_strpdt_special_t dt_io_strpdt_special(const char *str);
+
+/**
+ * Compile the NFMT input formats FMT so that dt_io_strpdt() and friends,
+ * when called with FMT, and needles built from FMT needn't tokenise them
+ * over and over again.  FMT must stay unchanged until dt_io_free_fmts().
+ * Return -1 if compiling failed in which case FMT is interpreted. */
+extern int dt_io_comp_fmts(char *const *fmt, size_t nfmt);
+extern void dt_io_free_fmts(void);
+
+/**
+ * Count how often each of the compiled input formats matches and
+ * print the tally to stderr with dt_io_fmts_stats(). */
+extern void dt_io_count_fmts(void);
+extern void dt_io_fmts_stats(void);
+
+/**
+ * Have the compiled input formats remember, per thread, the leading
+ * fields of their last match and the zone conversion of the last
+ * date/time, so that runs of date/times sharing a prefix are parsed
+ * from the first differing field on.
+ * Likewise the compiled output format remembers what it printed for
+ * the date, hour and minute of the last date/time. */
+extern void dt_io_memo_fmts(void);
+
 extern struct dt_dt_s
 dt_io_strpdt(
 	const char *str,
@@ -100,9 +152,70 @@ dt_io_find_strpdt2(
 	char **sp, char **ep,
 	zif_t zone);
 
+/**
+ * Compile the NFMT output formats FMT so that dt_io_strfdt() and
+ * friends, when called with one of them, needn't tokenise it over and
+ * over again.  FMT must stay unchanged until dt_io_free_ofmts().
+ * Return -1 if compiling failed in which case FMT is interpreted. */
+extern int dt_io_comp_ofmts(char *const *fmt, size_t nfmt);
+extern void dt_io_free_ofmts(void);
+
+/**
+ * Like dt_strfdt() but append APND_CH unless the result ends in it. */
+extern size_t
+dt_io_strfdt(
+	char *restrict buf, size_t bsz,
+	const char *fmt, struct dt_dt_s that, int apnd_ch);
+
 extern int
 dt_io_write(struct dt_dt_s d, const char *fmt, zif_t zone, int apnd_ch);
 
+/**
+ * Like dt_io_write() for each of the NFMT formats FMT, converting D to
+ * ZONE only once, the renderings are separated by SEP. */
+extern int
+dt_io_write_fmts(
+	struct dt_dt_s d, char *const *fmt, size_t nfmt, zif_t zone,
+	char sep, int apnd_ch);
+
+/**
+ * Binary columnar output, fixed-width little-endian records of the
+ * columns COL, preceded by a header describing them. */
+#define DT_IO_BIN_MAXCOL	(8U)
+
+struct dt_io_bin_s {
+	size_t ncol;
+	/* record size in bytes */
+	size_t rsz;
+	uint8_t col[DT_IO_BIN_MAXCOL];
+};
+
+/**
+ * Set up BIN from SPEC, a comma-separated list of the columns
+ * s (int64 epoch seconds), ns (int64 epoch nanoseconds),
+ * ldn (int32 lilian day number of the local date) and
+ * z (int32 zone offset in seconds).
+ * Return -1 if SPEC is malformed. */
+extern int dt_io_bin_cols(struct dt_io_bin_s *bin, const char *spec);
+
+/**
+ * Put the header describing the records of BIN into BUF.
+ * Return the header size, or 0 if BSZ is too small. */
+extern size_t
+dt_io_bin_hdr(char *restrict buf, size_t bsz, const struct dt_io_bin_s *bin);
+
+/**
+ * Put the record of D in ZONE into BUF, of at least BIN->rsz bytes,
+ * and return its size.  Unknown date/times yield null records, every
+ * column at its least value. */
+extern size_t
+dt_io_bin_rec(
+	char *restrict buf, const struct dt_io_bin_s *bin,
+	struct dt_dt_s d, zif_t zone);
+
+extern int
+dt_io_write_bin(struct dt_dt_s d, const struct dt_io_bin_s *bin, zif_t zone);
+
 /* grep atoms */
 extern struct grep_atom_s calc_grep_atom(const char *fmt);
 
@@ -141,22 +254,6 @@ make_grep_atom_soa(grep_atom_t atoms, size_t natoms)
 
 #define GRPATM_NEEDLELESS_MODE_CHAR	(1)
 
-/* formatter */
-static inline size_t
-dt_io_strfdt(
-	char *restrict buf, size_t bsz,
-	const char *fmt, struct dt_dt_s that, int apnd_ch)
-{
-	size_t res = dt_strfdt(buf, bsz, fmt, that);
-
-	if (LIKELY(res > 0) && apnd_ch && buf[res - 1] != apnd_ch) {
-		/* auto-newline */
-		buf[res++] = (char)apnd_ch;
-	}
-	return res;
-}
-
-
 static __attribute__((unused)) size_t
 __io_write(const char *line, size_t llen, FILE *where)
 {
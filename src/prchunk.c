@@ -51,14 +51,48 @@
 #include <string.h>
 #include <stdint.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <stdarg.h>
 #include <errno.h>
+#if defined HAVE_PTHREAD_H
+# include <pthread.h>
+# include <poll.h>
+#endif	/* HAVE_PTHREAD_H */
+#if defined HAVE_ZLIB_H && defined HAVE_LIBZ
+# define PRCHUNK_GZIP
+# include <zlib.h>
+#endif	/* HAVE_ZLIB_H && HAVE_LIBZ */
+#if defined HAVE_ZSTD_H && defined HAVE_LIBZSTD
+# define PRCHUNK_ZSTD
+# include <zstd.h>
+#endif	/* HAVE_ZSTD_H && HAVE_LIBZSTD */
+#if defined __AVX2__ || defined __SSE2__
+# include <immintrin.h>
+#endif	/* __AVX2__ || __SSE2__ */
 
 #include "nifty.h"
 #include "prchunk.h"
 
-#define MAX_NLINES	(16384)
-#define MAX_LLEN	(1024)
+/* we read in portions of CHUNK_SIZE bytes */
+#define CHUNK_SIZE	(4096U)
+/* initial buffer size and line capacity, both of which double
+ * whenever a chunk fills them up */
+#define INI_BSZ		(4U * CHUNK_SIZE)
+#define INI_NLINES	(256U)
+/* soft limits, beyond these a chunk is handed out to the caller
+ * rather than grown any further, only overlong lines can push the
+ * buffer past MAX_BSZ (up to the hard limit of our offset type) */
+#define MAX_BSZ		(4U * 1024U * 1024U)
+#define MAX_NLINES	(65536U)
+/* line offsets are kept in 31 bits (see set_loff()), and the offset one
+ * past the end of a buffer or window has to fit, so both stay below this */
+#define HARD_BSZ	(1U << 31U)
+/* size of the file windows we map when reading regular files */
+#define INI_WSZ		(16U * 1024U * 1024U)
+/* size of the read-ahead blocks, at most that much is read at once */
+#define RA_BSZ		(1024U * 1024U)
+/* size of the compressed input buffer */
+#define DEC_BSZ		(128U * 1024U)
 
 #if !defined MAP_ANONYMOUS && defined MAP_ANON
 # define MAP_ANONYMOUS	(MAP_ANON)
@@ -71,13 +105,69 @@
 #endif	/* __INTEL_COMPILER */
 
 typedef uint32_t off32_t;
-typedef uint16_t off16_t;
+
+#if defined HAVE_PTHREAD_H
+/* read-ahead, a reader thread fills one block while the other one is
+ * being consumed by prchunk_fill() */
+struct prch_ra_s {
+	pthread_t thr;
+	int fd;
+	/* everything below is guarded by MTX */
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;
+	char *blk[2U];
+	/* number of bytes in a block, 0 for end of file, -1 for errors */
+	ssize_t len[2U];
+	/* errno of the failed read, if any */
+	int err;
+	/* non-0 if the block is ready for consumption */
+	int fullp[2U];
+	int stopp;
+	/* block and offset currently consumed */
+	unsigned int rd;
+	size_t roff;
+};
+#endif	/* HAVE_PTHREAD_H */
+
+/* input sniffer and decompressor, sits between the reader and the
+ * line splitter, compressed input is never mapped */
+typedef enum {
+	DEC_UNK,
+	DEC_RAW,
+	DEC_GZIP,
+	DEC_ZSTD,
+} prch_dec_t;
+
+struct prch_dec_s {
+	prch_dec_t typ;
+	/* compressed input, or in the raw case the sniffed bytes */
+	char *ibuf;
+	size_t ioff;
+	size_t ilen;
+	int eofp;
+	/* non-0 while inside a gzip member or zstd frame, so the end of
+	 * input would truncate it */
+	int midp;
+#if defined PRCHUNK_GZIP
+	z_stream z;
+#endif	/* PRCHUNK_GZIP */
+#if defined PRCHUNK_ZSTD
+	ZSTD_DStream *zs;
+#endif	/* PRCHUNK_ZSTD */
+};
 
 struct prch_ctx_s {
 	/* file descriptor */
 	int fd;
-	/* buffer */
+	/* non-0 if buf is a window into the file mapped at file offset
+	 * foff, of a file of size fsz and a window size of wsz */
+	int mapped;
+	off_t foff;
+	off_t fsz;
+	size_t wsz;
+	/* buffer and its allocated size */
 	char *buf;
+	size_t bsz;
 	/* number of lines in the buffer */
 	uint32_t tot_lno;
 	/* number of columns per line */
@@ -86,11 +176,24 @@ struct prch_ctx_s {
 	size_t bno;
 	/* last known offset */
 	size_t off;
-	/* offsets */
-	off32_t loff[MAX_NLINES];
+	/* offset of the first line of the current chunk */
+	size_t coff;
+	/* offsets and their allocated number of slots */
+	off32_t *loff;
+	size_t nlmax;
 	off32_t cur_lno;
-	/* delimiter offsets */
-	off16_t *soff;
+	/* delimiter offsets and their allocated number of slots */
+	off32_t *soff;
+	size_t nsoff;
+	/* non-0 if we should read ahead */
+	int rahp;
+#if defined HAVE_PTHREAD_H
+	struct prch_ra_s *ra;
+#endif	/* HAVE_PTHREAD_H */
+	/* non-NULL until the input has been sniffed or if it's compressed */
+	struct prch_dec_s *dec;
+	/* why the input ended early, see prchunk_error() */
+	int err;
 };
 
 
@@ -127,13 +230,742 @@ static inline size_t
 get_llen(prch_ctx_t ctx, uint32_t lno)
 {
 	if (UNLIKELY(lno == 0)) {
-		return get_loff(ctx, 0) - lftermdp(ctx, 0);
+		return get_loff(ctx, 0) - lftermdp(ctx, 0) - ctx->coff;
 	}
 	return get_loff(ctx, lno) -
 		lftermdp(ctx, lno) -
 		get_loff(ctx, lno - 1) - 1;
 }
 
+static int
+resz_buf(prch_ctx_t ctx, size_t nu)
+{
+	char *tmp;
+
+	if (UNLIKELY(nu >= HARD_BSZ)) {
+		/* line too long for our offsets */
+		return -1;
+	} else if (UNLIKELY((tmp = realloc(ctx->buf, nu)) == NULL)) {
+		return -1;
+	}
+	ctx->buf = tmp;
+	ctx->bsz = nu;
+	return 0;
+}
+
+static int
+grow_loff(prch_ctx_t ctx)
+{
+	size_t nu = ctx->nlmax * 2U;
+	off32_t *tmp;
+
+	if (UNLIKELY((tmp = realloc(ctx->loff, nu * sizeof(*tmp))) == NULL)) {
+		return -1;
+	}
+	ctx->loff = tmp;
+	ctx->nlmax = nu;
+	return 0;
+}
+
+/* return non-0 if line number LNO cannot be stored, after possibly
+ * having grown the line offsets array */
+static inline int
+lno_full_p(prch_ctx_t ctx, uint32_t lno)
+{
+	if (LIKELY(lno < ctx->nlmax)) {
+		return 0;
+	} else if (ctx->nlmax >= MAX_NLINES) {
+		return 1;
+	}
+	return grow_loff(ctx) < 0;
+}
+
+
+/* line splitter */
+static inline int
+put_line(prch_ctx_t ctx, const char *lbeg, char *p)
+{
+/* record the line ending in P, \0-terminate it and return non-0 if
+ * there's no room for another line */
+	set_loff(ctx, ctx->tot_lno, p - ctx->buf);
+	if (UNLIKELY(p > lbeg && p[-1] == '\r')) {
+		/* oh god, when is this nightmare gonna end */
+		p[-1] = '\0';
+		set_lftermd(ctx, ctx->tot_lno);
+	}
+	*p = '\0';
+	/* count it as line and check if we need more */
+	return lno_full_p(ctx, ++ctx->tot_lno);
+}
+
+/* the vectorised splitter looks at blocks of 64 bytes and turns them
+ * into 64-bit masks of \n and \r positions */
+#if defined __AVX2__
+# define SPLT_WIDTH	(64U)
+static inline uint64_t
+splt_mask(const char *blk, char c)
+{
+	const __m256i k = _mm256_set1_epi8(c);
+	const __m256i x0 = _mm256_loadu_si256((const __m256i*)blk + 0U);
+	const __m256i x1 = _mm256_loadu_si256((const __m256i*)blk + 1U);
+	uint64_t m0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x0, k));
+	uint64_t m1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x1, k));
+
+	return m0 | m1 << 32U;
+}
+#elif defined __SSE2__
+# define SPLT_WIDTH	(64U)
+static inline uint64_t
+splt_mask(const char *blk, char c)
+{
+	const __m128i k = _mm_set1_epi8(c);
+	const __m128i x0 = _mm_loadu_si128((const __m128i*)blk + 0U);
+	const __m128i x1 = _mm_loadu_si128((const __m128i*)blk + 1U);
+	const __m128i x2 = _mm_loadu_si128((const __m128i*)blk + 2U);
+	const __m128i x3 = _mm_loadu_si128((const __m128i*)blk + 3U);
+	uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x0, k));
+	uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x1, k));
+	uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x2, k));
+	uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x3, k));
+
+	return m0 | m1 << 16U | m2 << 32U | m3 << 48U;
+}
+#endif	/* __AVX2__ || __SSE2__ */
+
+#if defined SPLT_WIDTH
+static inline void
+put_lines_blk(prch_ctx_t ctx, char *blk, uint64_t nlm, uint64_t crm)
+{
+/* record all lines ending in the block BLK, bits in NLM are \n positions
+ * bits in CRM mark those \ns that are preceded by \r,
+ * the caller makes sure there's room for SPLT_WIDTH more lines */
+	for (; nlm; nlm &= nlm - 1U) {
+		const unsigned int i = __builtin_ctzll(nlm);
+		const unsigned int crp = (crm >> i) & 1U;
+		char *p = blk + i;
+
+		ctx->loff[ctx->tot_lno++] = (off32_t)((p - ctx->buf) << 1U) | crp;
+		/* \0-terminate, also over the \r if any */
+		p[-(ptrdiff_t)crp] = '\0';
+		*p = '\0';
+	}
+	return;
+}
+#endif	/* SPLT_WIDTH */
+
+/* find all line ends in [OFF, BNO) in one sweep, return the beginning
+ * of the first line that is either unterminated or has no room in
+ * the offsets array, in which case *FULLP is set too */
+static char*
+split_lines(prch_ctx_t ctx, char *off, char *const bno, int *fullp)
+{
+	char *lbeg = off;
+
+	*fullp = 0;
+#if defined SPLT_WIDTH
+	for (uint64_t carry = 0U; off + SPLT_WIDTH <= bno; off += SPLT_WIDTH) {
+		const uint64_t nlm = splt_mask(off, '\n');
+		const uint64_t crm = splt_mask(off, '\r');
+
+		if (UNLIKELY(ctx->tot_lno + SPLT_WIDTH >= ctx->nlmax)) {
+			if (ctx->nlmax >= MAX_NLINES || grow_loff(ctx) < 0) {
+				/* let the scalar loop deal with the limit */
+				break;
+			}
+		}
+		if (nlm) {
+			put_lines_blk(ctx, off, nlm, nlm & (crm << 1U | carry));
+			lbeg = off + (63U - __builtin_clzll(nlm)) + 1U;
+		}
+		carry = crm >> (SPLT_WIDTH - 1U);
+	}
+#endif	/* SPLT_WIDTH */
+	/* the rest, or everything on the scalar path */
+	for (char *p; off < bno && (p = memchr(off, '\n', bno - off)); ) {
+		if (UNLIKELY(put_line(ctx, lbeg, p))) {
+			*fullp = 1;
+			return p + 1;
+		}
+		off = lbeg = p + 1;
+	}
+	return lbeg;
+}
+
+static size_t
+get_pgsz(void)
+{
+	static size_t pgsz;
+
+	if (UNLIKELY(!pgsz)) {
+		long rc = sysconf(_SC_PAGESIZE);
+		pgsz = rc > 0 ? (size_t)rc : 4096U;
+	}
+	return pgsz;
+}
+
+static void
+unmap_win(prch_ctx_t ctx)
+{
+	if (ctx->buf != NULL) {
+		munmap(ctx->buf, ctx->bsz + get_pgsz());
+		ctx->buf = NULL;
+	}
+	return;
+}
+
+/* map the file window that starts with the byte at file offset FPOS
+ * the window is followed by at least one page of zeroes, so a final
+ * unterminated line still has room for its \0
+ * Lines are \0-terminated in place, so the mapping is private and every
+ * page with a line end in it is copied on write, by the kernel rather
+ * than by read(), what we save is the syscall per chunk.
+ * The mapping also assumes the file keeps its size, prchunk_fill_map()
+ * checks that before each chunk and otherwise resorts to read(), a file
+ * truncated while a window is in use still raises SIGBUS though. */
+static int
+map_win(prch_ctx_t ctx, off_t fpos)
+{
+#define MAP_MEM		(MAP_ANON | MAP_PRIVATE)
+#if defined MAP_POPULATE
+/* we're going to write \0s to every page anyway, so fault them in
+ * (and copy them) in one go */
+# define MAP_FIL	(MAP_FIXED | MAP_PRIVATE | MAP_POPULATE)
+#else  /* !MAP_POPULATE */
+# define MAP_FIL	(MAP_FIXED | MAP_PRIVATE)
+#endif	/* MAP_POPULATE */
+#define PROT_MEM	(PROT_READ | PROT_WRITE)
+	const size_t pgsz = get_pgsz();
+	const off_t beg = fpos & ~(off_t)(pgsz - 1U);
+	size_t len = ctx->fsz - beg;
+	char *p;
+
+	if (len > ctx->wsz) {
+		len = ctx->wsz;
+	}
+	unmap_win(ctx);
+	/* reserve the window plus a trailing page */
+	if ((p = mmap(NULL, len + pgsz, PROT_MEM, MAP_MEM, -1, 0)) == MAP_FAILED) {
+		return -1;
+	} else if (mmap(p, len, PROT_MEM, MAP_FIL, ctx->fd, beg) == MAP_FAILED) {
+		munmap(p, len + pgsz);
+		return -1;
+	}
+#if defined MADV_SEQUENTIAL
+	(void)madvise(p, len, MADV_SEQUENTIAL);
+#endif	/* MADV_SEQUENTIAL */
+#if defined POSIX_FADV_WILLNEED
+	if (ctx->rahp && beg + (off_t)len < ctx->fsz) {
+		/* have the kernel fetch the next window in the meantime */
+		(void)posix_fadvise(
+			ctx->fd, beg + (off_t)len, ctx->wsz, POSIX_FADV_WILLNEED);
+	}
+#endif	/* POSIX_FADV_WILLNEED */
+	ctx->buf = p;
+	ctx->bsz = len;
+	ctx->bno = len;
+	ctx->off = fpos - beg;
+	ctx->foff = beg;
+#undef MAP_MEM
+#undef MAP_FIL
+#undef PROT_MEM
+	return 0;
+}
+
+#if defined HAVE_PTHREAD_H
+static struct prch_ra_s *ra_init(int fd);
+#endif	/* HAVE_PTHREAD_H */
+
+static int
+unmap_file(prch_ctx_t ctx)
+{
+/* go back to read()ing the file, from the current line on */
+	const off_t pos = ctx->foff + (off_t)ctx->off;
+
+	unmap_win(ctx);
+	ctx->mapped = 0;
+	ctx->bsz = ctx->bno = ctx->off = ctx->coff = 0U;
+	if (UNLIKELY(lseek(ctx->fd, pos, SEEK_SET) < 0)) {
+		return -1;
+	} else if (UNLIKELY((ctx->buf = malloc(INI_BSZ)) == NULL)) {
+		return -1;
+	}
+	ctx->bsz = INI_BSZ;
+#if defined HAVE_PTHREAD_H
+	if (ctx->rahp) {
+		/* read-ahead was the kernel's job so far */
+		ctx->ra = ra_init(ctx->fd);
+	}
+#endif	/* HAVE_PTHREAD_H */
+	return 0;
+}
+
+static int
+prchunk_fill_map(prch_ctx_t ctx)
+{
+/* like prchunk_fill() but the buffer is a window into the file, instead
+ * of refilling we slide the window along once it's been consumed */
+	struct stat st;
+	char *off;
+	char *bno;
+
+	/* initial work, reset the line counters et al */
+	ctx->tot_lno = 0;
+	ctx->cur_lno = 0;
+	if (UNLIKELY(ctx->buf == NULL)) {
+		return -1;
+	} else if (UNLIKELY(fstat(ctx->fd, &st) < 0 || st.st_size != ctx->fsz)) {
+		/* the file is growing or shrinking, windows sized at open
+		 * would miss or fault, read() copes with both */
+		if (UNLIKELY(unmap_file(ctx) < 0)) {
+			return -1;
+		}
+		return prchunk_fill(ctx);
+	}
+	off = ctx->buf + ctx->off;
+	bno = ctx->buf + ctx->bno;
+	while (1) {
+		int fullp;
+
+		ctx->coff = ctx->off;
+		if ((off = split_lines(ctx, off, bno, &fullp)), fullp) {
+			break;
+		} else if (ctx->tot_lno) {
+			/* hand out what we've got */
+			break;
+		} else if (ctx->foff + (off_t)ctx->bno >= ctx->fsz) {
+			/* end of file, leaving at most an unterminated line */
+			if (off >= bno) {
+				return -1;
+			}
+			set_loff(ctx, ctx->tot_lno++, bno - ctx->buf);
+			*bno = '\0';
+			off = bno;
+			break;
+		} else if ((size_t)(off - ctx->buf) < get_pgsz()) {
+			/* sliding wouldn't get us anywhere, line too long */
+			if (UNLIKELY(ctx->wsz >= HARD_BSZ / 2U)) {
+				/* a doubled window would overflow */
+				ctx->err = ENOBUFS;
+				return -1;
+			}
+			ctx->wsz *= 2U;
+		}
+		/* slide the window to the current line */
+		if (UNLIKELY(map_win(ctx, ctx->foff + (off - ctx->buf)) < 0)) {
+			return -1;
+		}
+		off = ctx->buf + ctx->off;
+		bno = ctx->buf + ctx->bno;
+	}
+	ctx->off = off - ctx->buf;
+	return 0;
+}
+
+#if defined HAVE_PTHREAD_H
+static ssize_t
+ra_fill(int fd, char *buf, size_t bsz)
+{
+/* read into BUF, block for the first bytes only and then keep going
+ * for as long as there's input readily available */
+	struct pollfd pfd = {.fd = fd, .events = POLLIN};
+	size_t tot = 0U;
+
+	while (tot < bsz) {
+		ssize_t nrd = read(fd, buf + tot, bsz - tot);
+
+		if (nrd < 0 && errno == EINTR) {
+			continue;
+		} else if (nrd <= 0) {
+			return tot ? (ssize_t)tot : nrd;
+		} else if ((tot += nrd) < bsz && poll(&pfd, 1, 0) <= 0) {
+			break;
+		}
+	}
+	return tot;
+}
+
+static void*
+ra_run(void *arg)
+{
+	struct prch_ra_s *ra = arg;
+
+	/* we only want to be cancelled while blocking in read() */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	for (unsigned int i = 0U;; i ^= 1U) {
+		ssize_t nrd;
+		int stopp;
+		int e;
+
+		pthread_mutex_lock(&ra->mtx);
+		while (ra->fullp[i] && !ra->stopp) {
+			pthread_cond_wait(&ra->cnd, &ra->mtx);
+		}
+		stopp = ra->stopp;
+		pthread_mutex_unlock(&ra->mtx);
+		if (stopp) {
+			break;
+		}
+
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		nrd = ra_fill(ra->fd, ra->blk[i], RA_BSZ);
+		e = nrd < 0 ? errno : 0;
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+		pthread_mutex_lock(&ra->mtx);
+		ra->len[i] = nrd;
+		ra->err = e;
+		ra->fullp[i] = 1;
+		pthread_cond_broadcast(&ra->cnd);
+		pthread_mutex_unlock(&ra->mtx);
+		if (nrd <= 0) {
+			/* that's it */
+			break;
+		}
+	}
+	return NULL;
+}
+
+static ssize_t
+ra_read(struct prch_ra_s *ra, char *buf, size_t bsz)
+{
+/* like read() but from the read-ahead blocks */
+	const unsigned int i = ra->rd;
+	ssize_t len;
+	size_t n;
+
+	pthread_mutex_lock(&ra->mtx);
+	while (!ra->fullp[i]) {
+		pthread_cond_wait(&ra->cnd, &ra->mtx);
+	}
+	pthread_mutex_unlock(&ra->mtx);
+
+	if ((len = ra->len[i]) <= 0) {
+		/* sticky end of file or error */
+		errno = ra->err;
+		return len;
+	}
+	/* the block is ours until we hand it back */
+	n = (size_t)len - ra->roff;
+	n = n < bsz ? n : bsz;
+	memcpy(buf, ra->blk[i] + ra->roff, n);
+	if ((ra->roff += n) >= (size_t)len) {
+		pthread_mutex_lock(&ra->mtx);
+		ra->fullp[i] = 0;
+		pthread_cond_broadcast(&ra->cnd);
+		pthread_mutex_unlock(&ra->mtx);
+		ra->rd ^= 1U;
+		ra->roff = 0U;
+	}
+	return n;
+}
+
+static void
+ra_free(struct prch_ra_s *ra)
+{
+	pthread_mutex_lock(&ra->mtx);
+	ra->stopp = 1;
+	pthread_cond_broadcast(&ra->cnd);
+	pthread_mutex_unlock(&ra->mtx);
+	/* the reader might be stuck in read() */
+	pthread_cancel(ra->thr);
+	pthread_join(ra->thr, NULL);
+
+	pthread_mutex_destroy(&ra->mtx);
+	pthread_cond_destroy(&ra->cnd);
+	free(ra->blk[0U]);
+	free(ra);
+	return;
+}
+
+static struct prch_ra_s*
+ra_init(int fd)
+{
+	struct prch_ra_s *ra;
+
+	if (UNLIKELY((ra = calloc(1, sizeof(*ra))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((ra->blk[0U] = malloc(2U * RA_BSZ)) == NULL)) {
+		free(ra);
+		return NULL;
+	}
+	ra->blk[1U] = ra->blk[0U] + RA_BSZ;
+	ra->fd = fd;
+	pthread_mutex_init(&ra->mtx, NULL);
+	pthread_cond_init(&ra->cnd, NULL);
+	if (pthread_create(&ra->thr, NULL, ra_run, ra)) {
+		pthread_mutex_destroy(&ra->mtx);
+		pthread_cond_destroy(&ra->cnd);
+		free(ra->blk[0U]);
+		free(ra);
+		return NULL;
+	}
+	return ra;
+}
+#endif	/* HAVE_PTHREAD_H */
+
+static inline ssize_t
+raw_read(prch_ctx_t ctx, char *buf, size_t bsz)
+{
+	ssize_t nrd;
+
+#if defined HAVE_PTHREAD_H
+	if (ctx->ra != NULL) {
+		nrd = ra_read(ctx->ra, buf, bsz);
+	} else
+#endif	/* HAVE_PTHREAD_H */
+	do {
+		nrd = read(ctx->fd, buf, bsz);
+	} while (nrd < 0 && errno == EINTR);
+	if (UNLIKELY(nrd < 0)) {
+		ctx->err = errno ?: EIO;
+	}
+	return nrd;
+}
+
+
+/* decompression */
+static prch_dec_t
+dec_sniff(const char *buf, size_t len)
+{
+/* return the compression method of BUF by its magic, DEC_UNK if LEN
+ * bytes are too few to tell */
+	static const unsigned char gz[] = {0x1fU, 0x8bU};
+	static const unsigned char zs[] = {0x28U, 0xb5U, 0x2fU, 0xfdU};
+	int unkp = 0;
+
+	if (!memcmp(buf, gz, len < sizeof(gz) ? len : sizeof(gz))) {
+		if (len >= sizeof(gz)) {
+#if defined PRCHUNK_GZIP
+			return DEC_GZIP;
+#endif	/* PRCHUNK_GZIP */
+		}
+		unkp |= len < sizeof(gz);
+	}
+	if (!memcmp(buf, zs, len < sizeof(zs) ? len : sizeof(zs))) {
+		if (len >= sizeof(zs)) {
+#if defined PRCHUNK_ZSTD
+			return DEC_ZSTD;
+#endif	/* PRCHUNK_ZSTD */
+		}
+		unkp |= len < sizeof(zs);
+	}
+	return unkp ? DEC_UNK : DEC_RAW;
+}
+
+static int
+dec_init(struct prch_dec_s *dec)
+{
+	switch (dec->typ) {
+#if defined PRCHUNK_GZIP
+	case DEC_GZIP:
+		/* 32 means auto-detect gzip or zlib headers */
+		if (inflateInit2(&dec->z, 15 + 32) != Z_OK) {
+			return -1;
+		}
+		break;
+#endif	/* PRCHUNK_GZIP */
+#if defined PRCHUNK_ZSTD
+	case DEC_ZSTD:
+		if ((dec->zs = ZSTD_createDStream()) == NULL) {
+			return -1;
+		} else if (ZSTD_isError(ZSTD_initDStream(dec->zs))) {
+			ZSTD_freeDStream(dec->zs);
+			return -1;
+		}
+		break;
+#endif	/* PRCHUNK_ZSTD */
+	default:
+		break;
+	}
+	return 0;
+}
+
+static void
+free_dec(struct prch_dec_s *dec)
+{
+	switch (dec->typ) {
+#if defined PRCHUNK_GZIP
+	case DEC_GZIP:
+		inflateEnd(&dec->z);
+		break;
+#endif	/* PRCHUNK_GZIP */
+#if defined PRCHUNK_ZSTD
+	case DEC_ZSTD:
+		ZSTD_freeDStream(dec->zs);
+		break;
+#endif	/* PRCHUNK_ZSTD */
+	default:
+		break;
+	}
+	free(dec->ibuf);
+	free(dec);
+	return;
+}
+
+static int
+dec_refill(prch_ctx_t ctx, struct prch_dec_s *dec)
+{
+/* get more compressed input, return 0 on end of file */
+	ssize_t nrd;
+
+	if (dec->eofp) {
+		return 0;
+	} else if ((nrd = raw_read(ctx, dec->ibuf, DEC_BSZ)) < 0) {
+		return -1;
+	} else if (nrd == 0) {
+		dec->eofp = 1;
+	}
+	dec->ioff = 0U;
+	dec->ilen = nrd;
+	return nrd > 0;
+}
+
+#if defined PRCHUNK_GZIP || defined PRCHUNK_ZSTD
+static ssize_t
+dec_end(prch_ctx_t ctx, const struct prch_dec_s *dec)
+{
+/* end of the compressed input, which had better not be mid-stream */
+	if (UNLIKELY(dec->midp)) {
+		ctx->err = -1;
+		return -1;
+	}
+	return 0;
+}
+#endif	/* PRCHUNK_GZIP || PRCHUNK_ZSTD */
+
+#if defined PRCHUNK_GZIP
+static ssize_t
+dec_gzip(prch_ctx_t ctx, struct prch_dec_s *dec, char *buf, size_t bsz)
+{
+	z_stream *z = &dec->z;
+
+	z->next_out = (unsigned char*)buf;
+	z->avail_out = bsz;
+	while (z->avail_out == bsz) {
+		int rc;
+
+		if (dec->ioff >= dec->ilen) {
+			if ((rc = dec_refill(ctx, dec)) < 0) {
+				return -1;
+			} else if (!rc) {
+				return dec_end(ctx, dec);
+			}
+		}
+		z->next_in = (unsigned char*)dec->ibuf + dec->ioff;
+		z->avail_in = dec->ilen - dec->ioff;
+		rc = inflate(z, Z_NO_FLUSH);
+		dec->ioff = dec->ilen - z->avail_in;
+		dec->midp = 1;
+
+		if (rc == Z_STREAM_END) {
+			/* concatenated members are fine, like zcat(1) */
+			inflateReset(z);
+			dec->midp = 0;
+		} else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+			ctx->err = -1;
+			return -1;
+		}
+	}
+	return bsz - z->avail_out;
+}
+#endif	/* PRCHUNK_GZIP */
+
+#if defined PRCHUNK_ZSTD
+static ssize_t
+dec_zstd(prch_ctx_t ctx, struct prch_dec_s *dec, char *buf, size_t bsz)
+{
+	ZSTD_outBuffer out = {buf, bsz, 0U};
+
+	while (out.pos == 0U) {
+		ZSTD_inBuffer in;
+		size_t rc;
+
+		if (dec->ioff >= dec->ilen) {
+			int nrd;
+
+			if ((nrd = dec_refill(ctx, dec)) < 0) {
+				return -1;
+			} else if (!nrd) {
+				return dec_end(ctx, dec);
+			}
+		}
+		in = (ZSTD_inBuffer){dec->ibuf, dec->ilen, dec->ioff};
+		if (ZSTD_isError(rc = ZSTD_decompressStream(dec->zs, &out, &in))) {
+			ctx->err = -1;
+			return -1;
+		}
+		dec->ioff = in.pos;
+		/* 0 means the frame is done and flushed */
+		dec->midp = rc != 0U;
+	}
+	return out.pos;
+}
+#endif	/* PRCHUNK_ZSTD */
+
+static ssize_t
+dec_raw(prch_ctx_t ctx, struct prch_dec_s *dec, char *buf, size_t bsz)
+{
+/* hand out the sniffed bytes, then get out of the way */
+	size_t n = dec->ilen - dec->ioff;
+
+	n = n < bsz ? n : bsz;
+	memcpy(buf, dec->ibuf + dec->ioff, n);
+	if ((dec->ioff += n) >= dec->ilen) {
+		free_dec(dec);
+		ctx->dec = NULL;
+	}
+	return n;
+}
+
+static ssize_t
+dec_read(prch_ctx_t ctx, char *buf, size_t bsz)
+{
+	struct prch_dec_s *dec = ctx->dec;
+
+	while (UNLIKELY(dec->typ == DEC_UNK)) {
+		/* sniff, more bytes are only needed if what we've got
+		 * could be the beginning of a magic number */
+		ssize_t nrd = raw_read(
+			ctx, dec->ibuf + dec->ilen, DEC_BSZ - dec->ilen);
+
+		if (nrd < 0) {
+			return -1;
+		} else if (nrd == 0) {
+			dec->eofp = 1;
+			dec->typ = DEC_RAW;
+		} else if ((dec->typ = dec_sniff(
+				    dec->ibuf, dec->ilen += nrd)) == DEC_RAW) {
+			;
+		} else if (dec->typ != DEC_UNK && dec_init(dec) < 0) {
+			dec->typ = DEC_RAW;
+			ctx->err = ENOMEM;
+			return -1;
+		}
+	}
+	switch (dec->typ) {
+#if defined PRCHUNK_GZIP
+	case DEC_GZIP:
+		return dec_gzip(ctx, dec, buf, bsz);
+#endif	/* PRCHUNK_GZIP */
+#if defined PRCHUNK_ZSTD
+	case DEC_ZSTD:
+		return dec_zstd(ctx, dec, buf, bsz);
+#endif	/* PRCHUNK_ZSTD */
+	default:
+		break;
+	}
+	return dec_raw(ctx, dec, buf, bsz);
+}
+
+static inline ssize_t
+fill_read(prch_ctx_t ctx, char *buf, size_t bsz)
+{
+	if (UNLIKELY(ctx->dec != NULL)) {
+		return dec_read(ctx, buf, bsz);
+	}
+	return raw_read(ctx, buf, bsz);
+}
+
 
 /* internal operations */
 FDEFU int
@@ -142,40 +974,65 @@ prchunk_fill(prch_ctx_t ctx)
 /* this is a coroutine consisting of a line counter yielding the number of
  * lines read so far and a reader yielding a buffer fill and the number of
  * bytes read */
-#define CHUNK_SIZE	(4096)
 #define YIELD(x)	goto yield##x
-	char *off = ctx->buf + 0;
-	char *bno = ctx->buf + ctx->bno;
+	char *off;
+	char *bno;
 	ssize_t nrd;
 
+	if (ctx->mapped) {
+		return prchunk_fill_map(ctx);
+	}
 	/* initial work, reset the line counters et al */
 	ctx->tot_lno = 0;
-	/* we just memcpy() the left over stuff to the front and restart
+	/* we just move the left over stuff to the front and restart
 	 * from there, someone left us a note in __ctx with the left
-	 * over offset */
-	/* normally we'd use memmove() but we know there's little chance
-	 * for overlapping regions */
+	 * over offset, overlong lines may well overlap the front */
 	if (UNLIKELY(ctx->bno == 0)) {
 		/* do nothing */
 		;
 	} else if (LIKELY(ctx->bno > ctx->off)) {
 		size_t rsz = ctx->bno - ctx->off;
 		/* move the top RSZ bytes to the beginning */
-		memcpy(ctx->buf, ctx->buf + ctx->off, rsz);
+		memmove(ctx->buf, ctx->buf + ctx->off, rsz);
 		ctx->bno = rsz;
-		bno = ctx->buf + rsz;
 	} else if (UNLIKELY(ctx->bno == ctx->off)) {
 		/* what are the odds? just reset the counters */
 		ctx->bno = 0;
-		bno = ctx->buf;
 	} else {
 		/* the user didn't see the end of the file */
 		return -1;
 	}
+	if (UNLIKELY(ctx->bsz > MAX_BSZ && ctx->bno + CHUNK_SIZE <= MAX_BSZ)) {
+		/* the overlong line is gone, give back the memory */
+		(void)resz_buf(ctx, MAX_BSZ);
+	}
+	off = ctx->buf + 0;
+	bno = ctx->buf + ctx->bno;
 
 yield1:
-	/* read CHUNK_SIZE bytes */
-	bno += (nrd = read(ctx->fd, bno, CHUNK_SIZE));
+	if (UNLIKELY(bno + CHUNK_SIZE > ctx->buf + ctx->bsz)) {
+		/* no room for another read, hand out the lines we've got
+		 * unless the buffer is still allowed to grow or the
+		 * current line alone fills it up */
+		const size_t o = off - ctx->buf;
+		const size_t b = bno - ctx->buf;
+
+		if (off > ctx->buf && ctx->bsz >= MAX_BSZ) {
+			YIELD(3);
+		} else if (UNLIKELY(resz_buf(ctx, ctx->bsz * 2U) < 0)) {
+			/* line too long or out of memory */
+			ctx->err = ctx->bsz * 2U >= HARD_BSZ ? ENOBUFS : ENOMEM;
+			return -1;
+		}
+		off = ctx->buf + o;
+		bno = ctx->buf + b;
+	}
+	/* read CHUNK_SIZE bytes, errors end the input just like the end
+	 * of file does, prchunk_error() tells them apart */
+	if (UNLIKELY(ctx->err) || (nrd = fill_read(ctx, bno, CHUNK_SIZE)) < 0) {
+		nrd = 0;
+	}
+	bno += nrd;
 	/* if we came from yield2 then off == __ctx->bno, and if we
 	 * read 0 or less bytes then off >= __ctx->bno + nrd, so we
 	 * can simply use that compact expression if the buffer has no
@@ -184,15 +1041,25 @@ yield1:
 	 * has been called, then off would be 0 and __ctx->bno would be
 	 * the buffer filled so far, if no more bytes could be read then
 	 * we'd proceed processing them (off < __ctx->bno + nrd */
-	if (UNLIKELY(!nrd && off < bno && ctx->cur_lno <= ctx->tot_lno)) {
-		/* last line then, unyielded :| */
+	if (UNLIKELY(!nrd && off < bno)) {
+		/* last line then, unyielded :|
+		 * we used to insist on the caller's line counter being
+		 * no further than ours, but with chunks of varying sizes
+		 * that would drop the final chunk entirely */
+		with (int fullp) {
+			/* left overs of a full chunk still hold whole lines */
+			if ((off = split_lines(ctx, off, bno, &fullp)), fullp) {
+				YIELD(3);
+			} else if (off >= bno) {
+				YIELD(3);
+			}
+		}
 		set_loff(ctx, ctx->tot_lno, bno - ctx->buf);
+		*bno = '\0';
 		off = bno;
-		/* count it as line and check if we need more */
-		if (++ctx->tot_lno >= MAX_NLINES) {
-			YIELD(3);
-		}
-		YIELD(4);
+		/* count it as line, there's no more to come anyway */
+		(void)lno_full_p(ctx, ++ctx->tot_lno);
+		YIELD(3);
 	} else if (UNLIKELY(nrd <= 0 && off == ctx->buf)) {
 		/* special case, we worked our arses off and nothing's
 		 * in the pipe line so just fuck off here */
@@ -207,28 +1074,13 @@ yield1:
 	/* proceed to exit */
 	YIELD(3);
 yield2:
-	while (off < bno) {
-		size_t rsz = bno - off;
-		char *p = memchr(off, '\n', rsz);
-		if (UNLIKELY(p == NULL)) {
-			if (LIKELY(nrd > 0)) {
-				break;
-			}
-			/* not concluded with \n, let's hope we're in drain mode */
-			return -1;
-		}
+	with (int fullp) {
 		/* massage our status structures */
-		set_loff(ctx, ctx->tot_lno, p - ctx->buf);
-		if (UNLIKELY(p[-1] == '\r')) {
-			/* oh god, when is this nightmare gonna end */
-			p[-1] = '\0';
-			set_lftermd(ctx, ctx->tot_lno);
-		}
-		*p = '\0';
-		off = ++p;
-		/* count it as line and check if we need more */
-		if (++ctx->tot_lno >= MAX_NLINES) {
+		if ((off = split_lines(ctx, off, bno, &fullp)), fullp) {
 			YIELD(3);
+		} else if (UNLIKELY(off < bno && nrd <= 0)) {
+			/* not concluded with \n, let's hope we're in drain mode */
+			return -1;
 		}
 	}
 	YIELD(1);
@@ -236,59 +1088,144 @@ yield3:
 	/* need clean up, something like unread(),
 	 * in particular leave a note in __ctx with the left over offset */
 	ctx->cur_lno = 0;
-yield4:
 	ctx->off = off - ctx->buf;
 	ctx->bno = bno - ctx->buf;
 #undef YIELD
-#undef CHUNK_SIZE
 	return 0;
 }
 
 
 /* public operations */
-FDEFU prch_ctx_t
-init_prchunk(int fd)
+static int
+init_map(prch_ctx_t ctx)
 {
-#define MAP_MEM		(MAP_ANON | MAP_PRIVATE)
-#define PROT_MEM	(PROT_READ | PROT_WRITE)
-#define MAP_LEN		(MAX_NLINES * MAX_LLEN)
-	static struct prch_ctx_s __ctx;
+/* regular files are mapped rather than read */
+	struct stat st;
+	off_t pos;
 
-	__ctx.buf = mmap(NULL, MAP_LEN, PROT_MEM, MAP_MEM, -1, 0);
-	if (__ctx.buf == MAP_FAILED) {
-		return NULL;
+	if (fstat(ctx->fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		return -1;
+	} else if ((pos = lseek(ctx->fd, 0, SEEK_CUR)) < 0) {
+		return -1;
+	} else if (st.st_size <= pos) {
+		return -1;
+	}
+	ctx->fsz = st.st_size;
+	ctx->wsz = INI_WSZ;
+	if (map_win(ctx, pos) < 0) {
+		return -1;
+	} else if (dec_sniff(
+			   ctx->buf + ctx->off, ctx->bno - ctx->off) != DEC_RAW) {
+		/* compressed, or could be, that's for the reader to find out */
+		unmap_win(ctx);
+		ctx->bsz = ctx->bno = ctx->off = 0U;
+		return -1;
 	}
+	ctx->mapped = 1;
+	return 0;
+}
 
-	/* bit of space for the rechunker */
-	__ctx.soff = mmap(NULL, MAP_LEN, PROT_MEM, MAP_MEM, -1, 0);
-	if (__ctx.soff == MAP_FAILED) {
+FDEFU prch_ctx_t
+init_prchunk(int fd)
+{
+	prch_ctx_t res;
+
+	if (UNLIKELY((res = calloc(1, sizeof(*res))) == NULL)) {
 		return NULL;
+	} else if (UNLIKELY((res->loff = malloc(
+				     INI_NLINES * sizeof(*res->loff))) == NULL)) {
+		goto nul;
 	}
+	res->nlmax = INI_NLINES;
 
-	if ((__ctx.fd = fd) > STDIN_FILENO) {
+	if ((res->fd = fd) > STDIN_FILENO) {
 #if defined POSIX_FADV_SEQUENTIAL
 		/* give advice about our read pattern */
 		int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
 		if (UNLIKELY(rc < 0)) {
-			munmap(__ctx.soff, MAP_LEN);
-			return NULL;
+			goto nul;
 		}
 #endif	/* POSIX_FADV_SEQUENTIAL */
 	}
-	return &__ctx;
+	if (init_map(res) < 0) {
+		/* pipe, tty or whatever, use the read() buffer */
+		if (UNLIKELY((res->buf = malloc(INI_BSZ)) == NULL)) {
+			goto nul;
+		}
+		res->bsz = INI_BSZ;
+#if defined PRCHUNK_GZIP || defined PRCHUNK_ZSTD
+		/* find out about compression once we read */
+		if (UNLIKELY((res->dec = calloc(1, sizeof(*res->dec))) == NULL)) {
+			goto nul;
+		} else if (UNLIKELY((res->dec->ibuf = malloc(DEC_BSZ)) == NULL)) {
+			goto nul;
+		}
+#endif	/* PRCHUNK_GZIP || PRCHUNK_ZSTD */
+	}
+	return res;
+
+nul:
+	free_prchunk(res);
+	return NULL;
 }
 
 FDEFU void
 free_prchunk(prch_ctx_t ctx)
 {
-	if (LIKELY(ctx->buf != NULL)) {
-		munmap(ctx->buf, MAP_LEN);
-		ctx->buf = NULL;
+	if (UNLIKELY(ctx == NULL)) {
+		return;
+	}
+#if defined HAVE_PTHREAD_H
+	if (ctx->ra != NULL) {
+		ra_free(ctx->ra);
+	}
+#endif	/* HAVE_PTHREAD_H */
+	if (ctx->dec != NULL) {
+		free_dec(ctx->dec);
+	}
+	if (ctx->mapped) {
+		/* leave the file offset where a reader would have left it */
+		(void)lseek(ctx->fd, ctx->foff + ctx->off, SEEK_SET);
+		unmap_win(ctx);
+	} else if (LIKELY(ctx->buf != NULL)) {
+		free(ctx->buf);
+	}
+	if (LIKELY(ctx->loff != NULL)) {
+		free(ctx->loff);
 	}
+	if (ctx->soff != NULL) {
+		free(ctx->soff);
+	}
+	free(ctx);
 	return;
 }
 
+FDEFU int
+prchunk_readahead(prch_ctx_t ctx)
+{
+	if (ctx->rahp) {
+		/* already on */
+		return 0;
+	} else if (ctx->mapped) {
+		/* map_win() will advise the kernel from now on */
+		ctx->rahp = 1;
+#if defined POSIX_FADV_WILLNEED
+		(void)posix_fadvise(
+			ctx->fd, ctx->foff + (off_t)ctx->bsz, ctx->wsz,
+			POSIX_FADV_WILLNEED);
+#endif	/* POSIX_FADV_WILLNEED */
+		return 0;
+	}
+#if defined HAVE_PTHREAD_H
+	if (ctx->bno == 0U && (ctx->ra = ra_init(ctx->fd)) != NULL) {
+		ctx->rahp = 1;
+		return 0;
+	}
+#endif	/* HAVE_PTHREAD_H */
+	return -1;
+}
+
 
 /* accessors/iterators/et al. */
 FDEFU size_t
@@ -301,7 +1238,7 @@ FDEFU size_t
 prchunk_getlineno(prch_ctx_t ctx, char **p, int lno)
 {
 	if (UNLIKELY(lno <= 0)) {
-		*p = ctx->buf;
+		*p = ctx->buf + ctx->coff;
 		return get_llen(ctx, 0);
 	} else if (UNLIKELY((size_t)lno >= prchunk_get_nlines(ctx))) {
 		*p = NULL;
@@ -325,6 +1262,12 @@ prchunk_reset(prch_ctx_t ctx)
 	return;
 }
 
+FDEFU int
+prchunk_error(prch_ctx_t ctx)
+{
+	return ctx->err;
+}
+
 FDEFU int
 prchunk_haslinep(prch_ctx_t ctx)
 {
@@ -346,14 +1289,17 @@ prchunk_get_ncols(prch_ctx_t ctx)
 	return ctx->tot_cno;
 }
 
+/* column offset of columns a line doesn't have */
+#define NO_COL		((off32_t)-1)
+
 static inline void
 set_col_off(prch_ctx_t ctx, size_t lno, size_t cno, size_t off)
 {
-	ctx->soff[lno * prchunk_get_ncols(ctx) + cno] = (off16_t)off;
+	ctx->soff[lno * prchunk_get_ncols(ctx) + cno] = (off32_t)off;
 	return;
 }
 
-static inline off16_t
+static inline off32_t
 get_col_off(prch_ctx_t ctx, size_t lno, size_t cno)
 {
 	return ctx->soff[lno * prchunk_get_ncols(ctx) + cno];
@@ -361,7 +1307,8 @@ get_col_off(prch_ctx_t ctx, size_t lno, size_t cno)
 
 /* rechunker, chop the lines into smaller bits
  * Strategy is to go over all lines in the current chunk and
- * memchr() for the delimiter DELIM.
+ * memchr() for the delimiter DELIM, at most NCOLS - 1 times per line,
+ * the last column holds the rest of the line then.
  * Store the offsets into __ctx->soff and bugger off leaving a \0
  * where the delimiter was. */
 FDEFU void
@@ -369,55 +1316,64 @@ prchunk_rechunk(prch_ctx_t ctx, char dlm, int ncols)
 {
 /* very naive implementation, we prefer prchunk_rechunk_by_dstfld()
  * where a distance histogram demarks possible places */
-	size_t lno = 0;
-	size_t cno = 0;
-	char *line;
-	char *off;
-	char *p;
-	char *bno = ctx->buf + ctx->off;
-	size_t rsz;
+	const size_t nl = prchunk_get_nlines(ctx) ?: 1U;
+	size_t nsoff;
 
+	if (UNLIKELY(ncols <= 0)) {
+		set_ncols(ctx, 0U);
+		return;
+	} else if (UNLIKELY((nsoff = nl * ncols) > ctx->nsoff)) {
+		off32_t *tmp;
+
+		if ((tmp = realloc(ctx->soff, nsoff * sizeof(*tmp))) == NULL) {
+			set_ncols(ctx, 0U);
+			return;
+		}
+		ctx->soff = tmp;
+		ctx->nsoff = nsoff;
+	}
 	set_ncols(ctx, ncols);
-	off = line = ctx->buf;
-	rsz = bno - off;
-	while ((p = memchr(off, dlm, rsz)) != NULL) {
-		size_t co;
-		size_t llen = get_llen(ctx, lno);
-		while ((co = p - line) > llen) {
-			/* last column offset equals the length of the line */
-			set_col_off(ctx, lno, cno, llen);
-			/* get the new line */
-			line = ctx->buf + get_loff(ctx, lno++) + 1;
-			cno = 0;
+	for (size_t lno = 0U; lno < nl; lno++) {
+		char *line;
+		const size_t llen = prchunk_getlineno(ctx, &line, lno);
+		const char *const eol = line + llen;
+		size_t cno = 0U;
+
+		for (char *p = line, *q;
+		     cno + 1U < (size_t)ncols &&
+			     (q = memchr(p, dlm, eol - p)) != NULL; p = q + 1) {
+			/* store where the column ends within the line */
+			set_col_off(ctx, lno, cno++, q - line);
+			*q = '\0';
+		}
+		/* last column offset equals the length of the line */
+		set_col_off(ctx, lno, cno++, llen);
+		/* and mark the ones this line doesn't have */
+		for (; cno < (size_t)ncols; cno++) {
+			set_col_off(ctx, lno, cno, NO_COL);
 		}
-		/* store the offset of the column within the line */
-		set_col_off(ctx, lno, cno++, co);
-		/* prepare the counters for the next round */
-		*p = '\0';
-		off = ++p;
-		rsz = bno - off;
 	}
-	/* last column offset equals the length of the line */
-	rsz = get_llen(ctx, lno);
-	set_col_off(ctx, lno, cno, rsz);
 	return;
 }
 
 FDEFU size_t
 prchunk_getcolno(prch_ctx_t ctx, char **p, int lno, int cno)
 {
-	size_t co1, co2;
+	off32_t co1, co2;
 
 	if (UNLIKELY(cno < 0 || (size_t)cno >= prchunk_get_ncols(ctx))) {
 		*p = NULL;
 		return 0;
+	} else if (UNLIKELY((co1 = get_col_off(ctx, lno, cno)) == NO_COL)) {
+		/* line's too short */
+		*p = NULL;
+		return 0;
 	}
 	(void)prchunk_getlineno(ctx, p, lno);
 	if (UNLIKELY(cno == 0)) {
-		return get_col_off(ctx, lno, 0);
+		return co1;
 	}
 	/* likely case last */
-	co1 = get_col_off(ctx, lno, cno);
 	co2 = get_col_off(ctx, lno, cno - 1);
 	*p += co2 + 1;
 	return co1 - co2 - 1;
@@ -426,36 +1382,56 @@ prchunk_getcolno(prch_ctx_t ctx, char **p, int lno, int cno)
 
 #if defined STANDALONE
 #include <stdio.h>
+#include <time.h>
 
+/* splitter benchmark, reports lines per second for a file or stdin,
+ * pass -v to see the lines as well */
 int
 main(int argc, char *argv[])
 {
 	int fd;
 	prch_ctx_t ctx;
+	struct timespec t0, t1;
+	size_t nl = 0U;
+	int verbp = 0;
+	double dt;
 
+	if (argc > 1 && !strcmp(argv[1], "-v")) {
+		verbp = 1;
+		argv++;
+		argc--;
+	}
 	if (argc <= 1) {
 		fd = STDIN_FILENO;
 	} else if ((fd = open(argv[1], O_RDONLY)) < 0) {
+		perror("Error: cannot open file");
 		return 1;
 	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
 	/* get our prchunk up n running */
 	if ((ctx = init_prchunk(fd)) == NULL) {
-		error(errno, "Error: ctx NULL");
+		perror("Error: ctx NULL");
 		return 1;
 	}
 	/* fill the buffer */
 	while (!(prchunk_fill(ctx) < 0)) {
-		char *l[1];
-		size_t llen;
-		int i = 0;
+		while (prchunk_haslinep(ctx)) {
+			char *l[1];
+			size_t llen = prchunk_getline(ctx, l);
 
-		while ((llen = prchunk_getline(ctx, l))) {
-			fprintf(stderr, "%d (%zu) %s\n", i++, llen, l[0]);
+			if (verbp) {
+				fprintf(stderr, "%zu (%zu) %s\n", nl, llen, l[0]);
+			}
+			nl++;
 		}
 	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
 	/* and out */
 	free_prchunk(ctx);
 	close(fd);
+
+	dt = (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	printf("%zu lines in %.3fs, %.0f lines/s\n", nl, dt, (double)nl / dt);
 	return 0;
 }
 #endif	/* STANDALONE */
@@ -48,12 +48,27 @@
 
 typedef struct prch_ctx_s *prch_ctx_t;
 
-/* non-reentrant! */
+/* contexts are independent of each other, buffers start small and
+ * grow with the line lengths and chunk sizes seen on FD,
+ * regular files are mapped window by window instead of being read,
+ * for as long as their size stays put */
 FDECL prch_ctx_t init_prchunk(int fd);
 FDECL void free_prchunk(prch_ctx_t);
 
 FDECL int prchunk_fill(prch_ctx_t ctx);
 
+/* once prchunk_fill() returns -1, tell whether the input ended well (0),
+ * reading failed (the errno value, ENOBUFS for a line too long to be
+ * buffered) or it was corrupt or truncated compressed data (-1) */
+FDECL int prchunk_error(prch_ctx_t ctx);
+
+/* read the next chunk while the current one is being processed,
+ * in a thread of its own or, for mapped files, by the kernel,
+ * has to be called before the first prchunk_fill(), the file offset
+ * of CTX's descriptor is unspecified afterwards
+ * return -1 if read-ahead isn't possible */
+FDECL int prchunk_readahead(prch_ctx_t ctx);
+
 FDECL size_t prchunk_get_nlines(prch_ctx_t);
 FDECL size_t prchunk_get_ncols(prch_ctx_t);
 
@@ -42,6 +42,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <sys/time.h>
 #include <time.h>
@@ -99,6 +100,7 @@ proc_lines(char *const *fmt, size_t nfmt, const char *ofmt, int quietp)
 	size_t lno = 0;
 	int rc = 0;
 	void *pctx;
+	int e;
 
 	/* using the prchunk reader now */
 	if ((pctx = init_prchunk(STDIN_FILENO)) == NULL) {
@@ -112,6 +114,14 @@ proc_lines(char *const *fmt, size_t nfmt, const char *ofmt, int quietp)
 			rc |= proc_line(line, fmt, nfmt, ofmt, quietp);
 		}
 	}
+	if ((e = prchunk_error(pctx)) < 0) {
+		error("Error: corrupt or truncated compressed input on stdin");
+		rc = 1;
+	} else if (e > 0) {
+		errno = e;
+		serror("Error: cannot read from stdin");
+		rc = 1;
+	}
 	/* get rid of resources */
 	free_prchunk(pctx);
 	return rc;
@@ -2,7 +2,9 @@
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include "dt-core.h"
 
@@ -166,6 +168,119 @@ test_dt_no_fmt(void)
 	return res;
 }
 
+static int
+test_dt_v(void)
+{
+	/* strings back to back, not \nul-terminated */
+	static const char str[] =
+		"2012-03-28 12:34:56" "2012-03-28 12:35:00xyz"
+		"2012-02-30 00:00:00" "2012-03-28";
+	const char *strs[] = {str, str + 19U, str + 41U, str + 60U};
+	const size_t lens[] = {19U, 22U, 19U, 10U};
+	struct dt_dt_s d[4U];
+	char *eps[4U];
+	char buf[64U];
+	size_t z[4U];
+	size_t n;
+	int res = 0;
+
+	fprintf(stderr, "testing dt_strpdt_v() ...\n");
+	n = dt_strpdt_v(strs, lens, 4U, "%F %T", d, eps);
+
+	CHECK(n != 3U, "  PARSED %zu ... should be 3\n", n);
+	CHECK(d[0U].d.ymd.d != 28 || d[0U].t.hms.s != 56,
+	      "  1ST DATE/TIME WRONG\n");
+	CHECK(d[1U].t.hms.m != 35 || d[1U].t.hms.s != 0,
+	      "  2ND DATE/TIME WRONG\n");
+	CHECK(eps[1U] != strs[1U] + 19U,
+	      "  2ND END POINTER OFF BY %td\n", eps[1U] - strs[1U] - 19);
+	CHECK(!d[2U].fix, "  3RD DATE NOT FIXED UP\n");
+	CHECK(!dt_unk_p(d[3U]), "  4TH DATE/TIME PARSED ... but shouldn't\n");
+	CHECK(eps[3U] != strs[3U], "  4TH END POINTER MOVED\n");
+
+	fprintf(stderr, "testing dt_strfdt_v() ...\n");
+	n = dt_strfdt_v(buf, sizeof(buf), "%d.%m.%Y", d, 3U, z);
+
+	CHECK(n != 3U, "  PRINTED %zu ... should be 3\n", n);
+	CHECK(memcmp(buf, "28.03.2012\0" "28.03.2012\0" "29.02.2012", 33U),
+	      "  OUTPUT WRONG %s\n", buf);
+	CHECK(z[0U] != 10U || z[1U] != 10U || z[2U] != 10U,
+	      "  LENGTHS WRONG\n");
+
+	/* only 2 fit */
+	n = dt_strfdt_v(buf, 30U, "%d.%m.%Y", d, 3U, NULL);
+	CHECK(n != 2U, "  PRINTED %zu ... should be 2\n", n);
+	return res;
+}
+
+static int
+test_dt_prog(void)
+{
+	static const char *const fmts[] = {
+		NULL, "ywd", "%F", "%FT%T%Z", "%F %T.%N", "%T,%N%Z",
+	};
+	static const char *const strs[] = {
+		"2012-03-28", "12:34:56", "2012-03-28T12:34:56+01:00",
+		"2012-12-31T24:00:00", "2012-03-28T12:34:56.000001-09:30",
+	};
+	const size_t nstrs = sizeof(strs) / sizeof(*strs);
+	int res = 0;
+
+	fprintf(stderr, "testing dt_strfdt_run() ...\n");
+	for (size_t i = 0U; i < sizeof(fmts) / sizeof(*fmts); i++) {
+		dt_strfdt_prog_t p = dt_compile_strfdt(fmts[i]);
+
+		CHECK(p == NULL, "  CANNOT COMPILE %s\n", fmts[i]);
+		for (size_t j = 0U; p != NULL && j < nstrs; j++) {
+			struct dt_dt_s d = dt_strpdt(strs[j], NULL, NULL);
+			char buf[64U], ref[64U];
+			size_t z, zref;
+
+			z = dt_strfdt_run(buf, sizeof(buf), p, d);
+			zref = dt_strfdt(ref, sizeof(ref), fmts[i], d);
+			CHECK(z != zref || memcmp(buf, ref, z),
+			      "  %s WITH %s GIVES %s ... should be %s\n",
+			      strs[j], fmts[i], buf, ref);
+		}
+		dt_free_strfdt(p);
+	}
+	return res;
+}
+
+static int
+test_d_exact_heap(void)
+{
+	static const char ref[] = "2012-03-04";
+	struct dt_dt_s d;
+	char *str;
+	char *ep;
+	int res = 0;
+
+	/* exactly sized, so there's nothing to read past the \nul */
+	fprintf(stderr, "testing malloc'd %s ...\n", ref);
+	if ((str = malloc(sizeof(ref))) == NULL) {
+		return 1;
+	}
+	memcpy(str, ref, sizeof(ref));
+	d = dt_strpdt(str, NULL, &ep);
+
+	CHECK(!dt_sandwich_only_d_p(d), "  TYPE is not a d-only\n");
+	CHECK(d.d.typ != DT_YMD,
+	      "  TYPE DIFFERS %u ... should be %u\n",
+	      (unsigned int)d.d.typ,
+	      (unsigned int)DT_YMD);
+	CHECK(d.d.ymd.y != 2012 || d.d.ymd.m != 3 || d.d.ymd.d != 4,
+	      "  DATE %u-%u-%u ... should be 2012-3-4\n",
+	      (unsigned int)d.d.ymd.y,
+	      (unsigned int)d.d.ymd.m,
+	      (unsigned int)d.d.ymd.d);
+	CHECK(ep != str + sizeof(ref) - 1U,
+	      "  END POINTER AT %td ... should be %zu\n",
+	      ep - str, sizeof(ref) - 1U);
+	free(str);
+	return res;
+}
+
 int
 main(void)
 {
@@ -183,6 +298,18 @@ main(void)
 		res = 1;
 	}
 
+	if (test_dt_v() != 0) {
+		res = 1;
+	}
+
+	if (test_dt_prog() != 0) {
+		res = 1;
+	}
+
+	if (test_d_exact_heap() != 0) {
+		res = 1;
+	}
+
 	return res;
 }
 